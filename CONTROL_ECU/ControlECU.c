@@ -10,116 +10,244 @@ checking, open the door and activate the system alarm.
  * Author: Sarah Emil
  */
 #include <util/delay.h>
+#include <string.h>
 
 /* Include hardware abstraction layer drivers */
 #include "MOTOR_DC.h"
 #include "buzzer.h"
 #include "uart.h"
+#include "link.h"
+#include "protocol.h"
+#include "scheduler.h"
+#include "door.h"
+#include "kv_store.h"
+#include "audit_log.h"
 #include "external_eeprom.h"
 #include "twi.h"
 #include "timer.h"
 #include "std_types.h"
 #include "common_macros.h"
 
-#define MC1_READY 6
-#define MC2_READY 7
+/* Maximum number of digits in a password, limited by the LCD width */
+#define PASSWORD_MAX_LENGTH	16
 
-/* MC1 functions */
-#define SetNewPasswordFn	9
-#define GetOptionsFn		1
-#define EnterPasswordFn		2
-#define SetFirstPasswordFn	5
+/* External EEPROM layout: the password record rotates over a ring of slots to spread the wear */
+#define PASSWORD_RING_ADDRESS	0x0400	/* Page aligned */
+#define PASSWORD_RING_SLOTS		16		/* Each slot (2 pages) is written once every 16 password changes */
+/* The key-value store uses KV_BASE_ADDRESS .. KV_BASE_ADDRESS + 2 * KV_BANK_SIZE - 1 */
+/* The audit log uses AUDIT_BASE_ADDRESS .. AUDIT_BASE_ADDRESS + AUDIT_MAX_ENTRIES * AUDIT_ENTRY_SIZE - 1 */
 
-/* MC2 functions */
-#define ChangePasswordFn	3
-#define OpenDoorFn			4
+/* User slot of the password in the audit log, the system has a single password */
+#define PASSWORD_USER_SLOT		0
 
+/* Keys of the records of the key-value store */
+#define KEY_FAILURE_COUNTER		0
 
-/* Defined for timer number of compares */
-#define NUMBER_OF_COMPARE_MTACHES_PER_SECOND 31
+/* Consecutive wrong passwords that activate the alarm */
+#define MAX_FAILED_ATTEMPTS		3
+
+/* Duration of the alarm lockout after 3 consecutive wrong passwords */
+#define ALARM_TIME_SECONDS	60
+
+/* Time MC1 has to send both entries of the new password once the change was allowed */
+#define PASSWORD_CHANGE_WINDOW_MS	60000
+
+/* The audit log may be read until no MSG_AUDIT_DUMP came for this time once the password was checked */
+#define AUDIT_DUMP_WINDOW_MS	30000
+
+/* Periods of the periodic tasks */
+#define PROTOCOL_TASK_PERIOD_MS		1
+#define LINK_MONITOR_TASK_PERIOD_MS	10
+#define AUDIT_TASK_PERIOD_MS		100
 
 /*******************************************************************************
  *                               Functions' prototypes                         *
  *******************************************************************************/
 
+/* Description:
+ * Periodic task used for:
+ *  Checking for a request from MC1 without blocking
+ *  Handling the received request
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void ProtocolTask(void);
+
+/* Description:
+ * Event task used for stepping the door sequence, signalled at the end of every door phase
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void DoorTask(void);
+
+/* Description:
+ * Function used for:
+ *  Turning the buzzer on and locking the system for ALARM_TIME_SECONDS
+ *  Starting the countdown pushed to MC1 every second
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void StartAlarm(void);
+
+/* Description:
+ * Event task used for counting down the alarm, signalled every second while the alarm is on:
+ *  Send the seconds left to MC1
+ *  Turn the buzzer off and clear the count of wrong passwords at the end of the lockout
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void AlarmTask(void);
+
+/* Description:
+ * Function used for:
+ *  Call back of the alarm timer, runs from the system tick interrupt every second
+ *  Signal the alarm task
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void AlarmSecond(void);
+
+/* Description:
+ * Periodic task used for falling back to the base rate if the link is unreliable
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void LinkMonitorTask(void);
+
+/* Description:
+ * Periodic task used for writing the audit log entries staged for AUDIT_FLUSH_DELAY_MS,
+ * it bounds the entries lost by a power cut
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void AuditTask(void);
+
 /* Description:
  * Function used for the main menu decisions made by the user.
+ * The MSG_UNLOCK request carries the chosen action and the password, the password
+ * is checked, the decision sent back and the action carried out.
  *
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password is/will be saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password is/will be saved
+ * 		PROTOCOL_RequestType * Request: the MSG_UNLOCK request
+ * 		uint8 * PassPtr: pointer to the string where the entered password is saved
  *
  * OUTPUTS:N/A
  */
-void UserChoice(uint8 * PassPtr1, uint8 * PassPtr2);
+void UserChoice(const PROTOCOL_RequestType * Request, uint8 * PassPtr);
+
+/* Description:
+ * Function used to carry out the menu decision once the password was checked:
+ *  Open the door, allow the password change or allow reading the audit log if the password is correct
+ *  Activate the alarm after 3 consecutive wrong passwords
+ *  Keep the count of wrong passwords in the key-value store so a power cut does not reset it,
+ *  it stays at 3 until the end of the alarm
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+void ExecuteUserChoice(void);
+
+/* Description:
+ * Function used for answering MSG_DOOR_STATUS with the door phase and the seconds left in it
+ *
+ * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the MSG_DOOR_STATUS request
+ *
+ * OUTPUTS:	N/A
+ */
+void DoorStatus(const PROTOCOL_RequestType * Request);
 
 /* Description:
  * Function used for:
- *  Opening the door for 15 seconds
- *  waiting 3 seconds
- *  closing the door for 15 seconds
+ *  Call back of the door phase timer, runs from the system tick interrupt
+ *  Signal the door task to move the door to its next phase
  *
  * INPUTS:	N/A
  *
  * OUTPUTS:	N/A
  */
-void OpenDoor(void);
+void DoorPhaseOver(void);
 
 /* Description:
- * Function used to read the entered password from MC1 and save it in a string.
+ * Function used to copy the password digits carried by a request from MC1 in a string.
  *
  * INPUTS:
+ * 		uint8 * Digits: the password digits in the request payload
+ * 		uint8 Length: number of digits
  * 		uint8 * PassPtr: pointer to the string where the entered password will be saved
  *
- * OUTPUTS:N/A
+ * OUTPUTS:
+ * 		uint8: TRUE if the request holds a valid password, FALSE if it was rejected
  */
-void ReadEnteredPassword(uint8 * PassPtr);
+uint8 ReadEnteredPassword(const uint8 * Digits, uint8 Length, uint8 * PassPtr);
 
 /* Description:
- * Function used to check if the two entered passwords are equal and if yes save them in the EEPROM
+ * Function used to check if the two entered passwords are equal and if yes save them in the EEPROM,
+ * the decision sent back is TRUE only once the password was written
  *
  * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the request answered with the decision
  * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
  * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
  *
  * OUTPUTS:N/A
  */
 
-void SavePassword(uint8 * PassPtr1, uint8 * PassPtr2);
+void SavePassword(const PROTOCOL_RequestType * Request, uint8 * PassPtr1, uint8 * PassPtr2);
 
 /* Description:
- * Function used to read and store the two entered passwords and save them.
+ * Function used to read the two entries of a new password and save it.
+ * MSG_NEW_PASSWORD holds the first entry and MSG_CONFIRM_PASSWORD the second one,
+ * the confirmation ends the change allowed by the password check whatever its result.
  *
  * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the MSG_NEW_PASSWORD or MSG_CONFIRM_PASSWORD request
  * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
  * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
  *
  * OUTPUTS:N/A
  */
-void ChangePassword(uint8 * PassPtr1, uint8 * PassPtr2);
+void ChangePassword(const PROTOCOL_RequestType * Request, uint8 * PassPtr1, uint8 * PassPtr2);
 
 /* Description:
- * Function used to compare the two passwords and set the g_PasswordCorrectFlag accordingly and inform MC1 of the decision.
+ * Function used to compare the entered password with the cached saved one, set the g_PasswordCorrectFlag
+ * accordingly and inform MC1 of the decision. The EEPROM is not accessed.
  *
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
+ * 		PROTOCOL_RequestType * Request: the request answered with the decision
+ * 		uint8 * Digits: the entered password digits in the request payload
+ * 		uint8 Length: number of digits
+ * 		uint8 * PassPtr: pointer to the string where the entered password is saved
  *
  * OUTPUTS:N/A
  */
-void CheckPassword(uint8 * PassPtr1, uint8 * PassPtr2);
+void CheckPassword(const PROTOCOL_RequestType * Request, const uint8 * Digits, uint8 Length, uint8 * PassPtr);
 
 /* Description:
- * Function used for checking the flag in the EEPROM to determine if previous password is saved at first use
+ * Function used for checking if a previous password is saved at first use
  * Used after power cuts to prevent creating a new password
 
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password will be saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password will be saved
+ * 		PROTOCOL_RequestType * Request: the MSG_PASSWORD_STATUS request
  *
  * OUTPUTS:	N/A
  */
-void CheckForPreviouslySavedPassword(uint8 * PassPtr1, uint8 * PassPtr2);
+void CheckForPreviouslySavedPassword(const PROTOCOL_RequestType * Request);
 
 /* Description:
  * Function used for saving the new password in the EEPROM
@@ -127,44 +255,56 @@ void CheckForPreviouslySavedPassword(uint8 * PassPtr1, uint8 * PassPtr2);
  * INPUTS:
  * 		uint8 * PassPtr: pointer to the string where the password is saved
  *
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8: SUCCESS or ERROR if the EEPROM could not be written, the previous password is kept
  */
-void InformMC1(uint8 SelectedFn);
-
-void EEPROMStorePassword(uint8 * PassPtr);
+uint8 EEPROMStorePassword(uint8 * PassPtr);
 
 /* Description:
  * Function used for reading the saved password in the EEPROM
  *
  * INPUTS:
- * 		uint8 * PassPtr: pointer to the string where the password will be saved
+ * 		uint8 * PassPtr: pointer to the string (PASSWORD_MAX_LENGTH + 1 bytes) where the password will be saved
  *
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8: SUCCESS or ERROR if the EEPROM could not be read
  */
-void EEPROMRetrivePassword(uint8 * PassPtr);
+uint8 EEPROMRetrivePassword(uint8 * PassPtr);
 
 /* Description:
- * Function used for:
- *  Interrupt Service Routine for timer0 compare mode
- *  Set g_FinshedCounting flag to 1 every 1 second
+ * Function used for loading the saved password in the RAM cache at boot:
+ *  Find the newest password record in the ring of slots and read it
+ *  Keep the password only if the record is a valid password (digits only)
  *
  * INPUTS:	N/A
  *
  * OUTPUTS:	N/A
  */
-void TickCounter(void);
+void LoadPasswordCache(void);
 
 /* Description:
- * Function used for:
- *  Initializing Timer0 with the desired values
- *  Loop until reaching the desired number of delayed seconds
+ * Function used for checking that a password record read from the EEPROM holds a valid password
+ *
+ * INPUTS:
+ * 		uint8 * Record: the null terminated record
+ *
+ * OUTPUTS:
+ * 		uint8: TRUE if the record only holds digits
+ */
+uint8 ValidPasswordRecord(const uint8 * Record);
+
+/* Description:
+ * Function used for answering MSG_AUDIT_DUMP with the number of entries in the audit log
+ * and up to AUDIT_DUMP_MAX_ENTRIES entries from the requested index on,
+ * or with an empty response unless the password was just checked for UNLOCK_AUDIT_LOG
  *
  * INPUTS:
- * 		uint8 Seconds: Number of desired seconds to delay
+ * 		PROTOCOL_RequestType * Request: the MSG_AUDIT_DUMP request
  *
  * OUTPUTS:	N/A
  */
-void CountByTimer1(uint8 Seconds);
+void AuditDump(const PROTOCOL_RequestType * Request);
+
 
 
 
@@ -176,15 +316,44 @@ void CountByTimer1(uint8 Seconds);
 //uint8 First_Password_Flag=0;
 //EEPROM_readByte( 0x0311 , &First_Password_Flag );
 
-/* global variable contain the ticks count of the timer */
-uint8 g_tick = 0;
-
-/* global variable flag to indicate finish of counting desired number of seconds */
-uint8 g_FinshedCounting = 0;
-
 /* global variable flag to indicate the state of the password comparison */
 uint8 g_PasswordCorrectFlag = 0;
 
+/* RAM copy of the saved password, loaded at boot and written through on every change */
+uint8 g_SavedPassword[PASSWORD_MAX_LENGTH + 1];
+
+/* ring of EEPROM slots holding the password record, the newest slot is found at boot */
+EEPROM_RingType g_PasswordRing = {PASSWORD_RING_ADDRESS, PASSWORD_MAX_LENGTH, PASSWORD_RING_SLOTS, EEPROM_RING_EMPTY, 0};
+
+/* global variable flag set when g_SavedPassword holds a valid saved password */
+uint8 g_PasswordSavedFlag = FALSE;
+
+/* consecutive wrong passwords, kept in the key-value store */
+uint8 g_FailureCounter = 0;
+
+/* global variable holding the action of the last MSG_UNLOCK request, 0 when none is pending */
+uint8 g_UserChoice = 0;
+
+/* global variable flag allowing MSG_NEW_PASSWORD, set at first use or after the password was checked,
+ * cleared by the next MSG_UNLOCK or MSG_CONFIRM_PASSWORD and PASSWORD_CHANGE_WINDOW_MS after it was set */
+uint8 g_ChangeAllowedFlag = 0;
+uint32 g_ChangeAllowedTick = 0;
+
+/* global variable flag allowing MSG_AUDIT_DUMP, set after the password was checked for UNLOCK_AUDIT_LOG,
+ * cleared by the next MSG_UNLOCK and AUDIT_DUMP_WINDOW_MS after the last dump */
+uint8 g_AuditAllowedFlag = 0;
+uint32 g_AuditAllowedTick = 0;
+
+/* ids of the event tasks */
+uint8 g_DoorTask = SCHEDULER_INVALID_TASK;
+uint8 g_AlarmTask = SCHEDULER_INVALID_TASK;
+
+/* software timer counting the seconds of the alarm */
+uint8 g_AlarmTimer = SOFT_TIMER_INVALID;
+
+/* seconds left in the alarm lockout, 0 when the alarm is off */
+uint8 g_AlarmSecondsLeft = 0;
+
 int main(void)
 {
 
@@ -193,159 +362,369 @@ int main(void)
 	/*TWI_ConfigType TWI_Structure={P_1,FAST_MODE,0b00000010};*/
 	/*TWI_init(&TWI_Structure);*/
 
+	Tick_init();			/* Start the system tick used for the protocol timeouts and the software timers */
+	g_AlarmTimer = SoftTimer_create(AlarmSecond);
 	TWI_init();				/* Initialize the TWI/I2C Driver */
+	KV_init();				/* Rebuild the index of the key-value store */
+	LoadPasswordCache();	/* The password checks are served from RAM from now on */
+	KV_read(KEY_FAILURE_COUNTER, &g_FailureCounter, 1);	/* Left at 0 if never written */
+	AUDIT_init();			/* Find the newest entry of the audit log */
+	AUDIT_append(AUDIT_EVENT_BOOT, AUDIT_USER_NONE);
 	DcMotor_Init();			/* Initialize DC motor driver*/
+	DOOR_init(DoorPhaseOver);	/* Door locked, stepped by the door task */
 	Buzzer_init();			/* Initialize buzzer driver*/
 
-	/* Initialize the UART driver with Baud-rate = 9600 bits/sec, 1 stop bit, disabled parity and 8 bit character */
-	UART_ConfigType UART_Structure={EIGHT_BIT,DISABLED,ONE_BIT,9600};
-	UART_init(&UART_Structure);
+	/* Initialize the UART driver at the link base rate, MC1 negotiates a faster one at boot */
+	LINK_init();
+	PROTOCOL_init();
+
+	/* The count is only cleared at the end of the alarm, a power cut during the lockout does not end it */
+	if(g_FailureCounter >= MAX_FAILED_ATTEMPTS)
+	{
+		StartAlarm();
+		AUDIT_append(AUDIT_EVENT_LOCKOUT, PASSWORD_USER_SLOT);
+		AUDIT_flush();	/* A lockout is not left staged */
+	}
+
+	/* Tasks in decreasing order of priority */
+	SCHEDULER_addTask(ProtocolTask, PROTOCOL_TASK_PERIOD_MS);
+	g_DoorTask = SCHEDULER_addTask(DoorTask, 0);
+	g_AlarmTask = SCHEDULER_addTask(AlarmTask, 0);
+	SCHEDULER_addTask(LinkMonitorTask, LINK_MONITOR_TASK_PERIOD_MS);
+	SCHEDULER_addTask(AuditTask, AUDIT_TASK_PERIOD_MS);
 
+	SCHEDULER_run();
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Periodic task used for:
+ *  Checking for a request from MC1 without blocking
+ *  Handling the received request
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void ProtocolTask(void)
+{
 	/*Array of characters to store the two received passwords, size is 16 due to LCD limit and 1 place for the null */
-	uint8 Password_1[17];
-	uint8 Password_2[17];
+	static uint8 Password_1[PASSWORD_MAX_LENGTH + 1];
+	static uint8 Password_2[PASSWORD_MAX_LENGTH + 1];
 
+	PROTOCOL_RequestType Request;
+	uint8 Response;
 
-	while(1)
+	if(!PROTOCOL_pollRequest(&Request))
 	{
+		return;
+	}
 
-		/*Receive the chosen function from MC1 */
-		uint8 ChosenFunction;
-		ChosenFunction = UART_recieveByte();
+	switch(Request.type)
+	{
+	case MSG_LINK_NEGOTIATE:
+		Response = TRUE;
+		PROTOCOL_respond(&Request, &Response, 1);
+		LINK_negotiateSlave();
+		break;
 
-		switch(ChosenFunction)
-		{
-		case SetFirstPasswordFn:
-			CheckForPreviouslySavedPassword(Password_1, Password_2);
-			_delay_ms(500);
-			break;
+	case MSG_PASSWORD_STATUS:
+		CheckForPreviouslySavedPassword(&Request);
+		break;
 
-		case SetNewPasswordFn:
-			ChangePassword(Password_1, Password_2);
-			break;
+	case MSG_UNLOCK:
+		UserChoice(&Request, Password_2);
+		break;
+
+	case MSG_DOOR_STATUS:
+		DoorStatus(&Request);
+		break;
 
-		case GetOptionsFn:
-			UserChoice(Password_1, Password_2);
-			break;
+	case MSG_AUDIT_DUMP:
+		AuditDump(&Request);
+		break;
 
-		case EnterPasswordFn:
-			CheckPassword(Password_1, Password_2);
-			break;
+	case MSG_NEW_PASSWORD:
+	case MSG_CONFIRM_PASSWORD:
+		ChangePassword(&Request, Password_1, Password_2);
+		break;
 
-		}
 	}
 }
 /********************************************************************************************************/
 
+/* Description:
+ * Event task used for stepping the door sequence, signalled at the end of every door phase
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void DoorTask(void)
+{
+	DOOR_update();
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for:
+ *  Turning the buzzer on and locking the system for ALARM_TIME_SECONDS
+ *  Starting the countdown pushed to MC1 every second
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void StartAlarm(void)
+{
+	Buzzer_on();
+	g_AlarmSecondsLeft = ALARM_TIME_SECONDS;
+	SoftTimer_start(g_AlarmTimer, 1000, SOFT_TIMER_PERIODIC);
+	PROTOCOL_notify(MSG_ALARM_COUNTDOWN, &g_AlarmSecondsLeft, 1);
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Event task used for counting down the alarm, signalled every second while the alarm is on:
+ *  Send the seconds left to MC1
+ *  Turn the buzzer off and clear the count of wrong passwords at the end of the lockout
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void AlarmTask(void)
+{
+	if(g_AlarmSecondsLeft == 0)
+	{
+		return;
+	}
+
+	g_AlarmSecondsLeft--;
+	if(g_AlarmSecondsLeft == 0)
+	{
+		SoftTimer_stop(g_AlarmTimer);
+		Buzzer_off();
+		g_FailureCounter = 0;
+		KV_write(KEY_FAILURE_COUNTER, &g_FailureCounter, 1);
+	}
+	/* Sent every second, a lost countdown is corrected by the next one */
+	PROTOCOL_notify(MSG_ALARM_COUNTDOWN, &g_AlarmSecondsLeft, 1);
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for:
+ *  Call back of the alarm timer, runs from the system tick interrupt every second
+ *  Signal the alarm task
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void AlarmSecond(void)
+{
+	SCHEDULER_signal(g_AlarmTask);
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Periodic task used for falling back to the base rate if the link is unreliable
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void LinkMonitorTask(void)
+{
+	LINK_monitor();
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Periodic task used for writing the audit log entries staged for AUDIT_FLUSH_DELAY_MS,
+ * it bounds the entries lost by a power cut
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void AuditTask(void)
+{
+	AUDIT_flushExpired();
+}
+/********************************************************************************************************/
+
 /* Description:
  * Function used for the main menu decisions made by the user.
+ * The MSG_UNLOCK request carries the chosen action and the password, the password
+ * is checked, the decision sent back and the action carried out.
  *
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password is/will be saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password is/will be saved
+ * 		PROTOCOL_RequestType * Request: the MSG_UNLOCK request
+ * 		uint8 * PassPtr: pointer to the string where the entered password is saved
  *
  * OUTPUTS:N/A
  */
 
-void UserChoice(uint8 * PassPtr1, uint8 * PassPtr2)
+void UserChoice(const PROTOCOL_RequestType * Request, uint8 * PassPtr)
+{
+	uint8 Response = FALSE;
+
+	/* A change or dump allowed by an earlier request ends here, only a correct password now allows it again */
+	g_ChangeAllowedFlag = 0;
+	g_AuditAllowedFlag = 0;
+	g_UserChoice = (Request->length >= 1) ? Request->payload[0] : 0;
+	if(g_AlarmSecondsLeft != 0)
+	{
+		g_UserChoice = 0;	/* No password is checked during the alarm lockout */
+	}
+	switch(g_UserChoice){
+	case UNLOCK_OPEN_DOOR:
+	case UNLOCK_CHANGE_PASSWORD:
+	case UNLOCK_AUDIT_LOG:
+		/* The password digits follow the action */
+		CheckPassword(Request, &Request->payload[1], Request->length - 1, PassPtr);
+		ExecuteUserChoice();
+		break;
+	default:
+		g_UserChoice = 0;
+		PROTOCOL_respond(Request, &Response, 1);
+		break;
+	}
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used to carry out the menu decision once the password was checked:
+ *  Open the door, allow the password change or allow reading the audit log if the password is correct
+ *  Activate the alarm after 3 consecutive wrong passwords
+ *  Keep the count of wrong passwords in the key-value store so a power cut does not reset it,
+ *  it stays at 3 until the end of the alarm
+ *
+ * INPUTS:	N/A
+ *
+ * OUTPUTS:	N/A
+ */
+
+void ExecuteUserChoice(void)
 {
-	uint8 choice;
-	static uint8 FailureCounter=0;
-	choice = UART_recieveByte();
-	switch(choice){
-	case '+':
-		UART_sendByte(OpenDoorFn);	/* Inform MC1 about the selected choice*/
-		UART_recieveByte(); //dummy
-		CheckPassword(PassPtr1, PassPtr2);
-		if(g_PasswordCorrectFlag)
+	if(g_PasswordCorrectFlag)
+	{
+		g_FailureCounter = 0;
+		if(g_UserChoice == UNLOCK_OPEN_DOOR)
 		{
-			FailureCounter = 0;
-			OpenDoor();
+			DOOR_open();
+			AUDIT_append(AUDIT_EVENT_UNLOCK, PASSWORD_USER_SLOT);
 		}
-		else
+		else if(g_UserChoice == UNLOCK_CHANGE_PASSWORD)
 		{
-			FailureCounter++;
-			if (FailureCounter==3)
-			{
-				Buzzer_on();
-				CountByTimer1(60);
-				Buzzer_off();
-				FailureCounter = 0;
-			}
+			g_ChangeAllowedFlag = 1;
+			g_ChangeAllowedTick = Tick_getMs();
 		}
-		break;
-	case '-':
-		InformMC1(ChangePasswordFn);
-		CheckPassword(PassPtr1, PassPtr2);
-		if(g_PasswordCorrectFlag)
+		else if(g_UserChoice == UNLOCK_AUDIT_LOG)
 		{
-			FailureCounter = 0;
-			UART_recieveByte(); //dummy
-			ChangePassword(PassPtr1, PassPtr2);
+			g_AuditAllowedFlag = 1;
+			g_AuditAllowedTick = Tick_getMs();
 		}
-		else
+	}
+	else
+	{
+		g_FailureCounter++;
+		AUDIT_append(AUDIT_EVENT_WRONG_PASSWORD, PASSWORD_USER_SLOT);
+		if (g_FailureCounter>=MAX_FAILED_ATTEMPTS)
 		{
-			FailureCounter++;
-			if (FailureCounter==3)
-			{
-				Buzzer_on();
-				CountByTimer1(60);
-				Buzzer_off();
-				FailureCounter = 0;
-			}
+			StartAlarm();
+			AUDIT_append(AUDIT_EVENT_LOCKOUT, PASSWORD_USER_SLOT);
+			AUDIT_flush();	/* A lockout is not left staged */
 		}
-		break;
 	}
+	/* The store does not write an unchanged count again */
+	KV_write(KEY_FAILURE_COUNTER, &g_FailureCounter, 1);
+	g_UserChoice = 0;
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for answering MSG_DOOR_STATUS with the door phase and the seconds left in it
+ *
+ * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the MSG_DOOR_STATUS request
+ *
+ * OUTPUTS:	N/A
+ */
+
+void DoorStatus(const PROTOCOL_RequestType * Request)
+{
+	uint8 Response[2];
+
+	/* DOOR_PhaseType is in the order of the DOOR_STATUS_ values */
+	Response[0] = (uint8)DOOR_getPhase();
+	/* Round up so the door is only reported as 0 seconds away once it is locked */
+	Response[1] = (uint8)((DOOR_getRemainingMs() + 999) / 1000);
+	PROTOCOL_respond(Request, Response, 2);
 }
 /********************************************************************************************************/
 
 /* Description:
  * Function used for:
- *  Opening the door for 15 seconds
- *  waiting 3 seconds
- *  closing the door for 15 seconds
+ *  Call back of the door phase timer, runs from the system tick interrupt
+ *  Signal the door task to move the door to its next phase
  *
  * INPUTS:	N/A
  *
  * OUTPUTS:	N/A
  */
 
-void OpenDoor(void)
+void DoorPhaseOver(void)
 {
-	DcMotor_Rotate (CLOCKWISE,100);
-	CountByTimer1(15);
-	DcMotor_Rotate (STOP,0);
-	CountByTimer1(10);
-	DcMotor_Rotate (ANTI_CLOCKWISE,100);
-	CountByTimer1(15);
-	DcMotor_Rotate (STOP,0);
+	SCHEDULER_signal(g_DoorTask);
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used to read the entered password from MC1 and save it in a string.
+ * Function used to copy the password digits carried by a request from MC1 in a string.
  *
  * INPUTS:
+ * 		uint8 * Digits: the password digits in the request payload
+ * 		uint8 Length: number of digits
  * 		uint8 * PassPtr: pointer to the string where the entered password will be saved
  *
- * OUTPUTS:N/A
+ * OUTPUTS:
+ * 		uint8: TRUE if the request holds a valid password, FALSE if it was rejected
  */
 
-void ReadEnteredPassword(uint8 * PassPtr)
+uint8 ReadEnteredPassword(const uint8 * Digits, uint8 Length, uint8 * PassPtr)
 {
-	uint8 RecievedCharacter, counter=0;
-
-	UART_sendByte(MC2_READY);	/* Send MC2_READY byte to MC1 to ask it to send the string */
-	UART_receiveString(PassPtr);
-	_delay_ms(1000);
+	uint8 Counter;
 
+	if(Length > PASSWORD_MAX_LENGTH)
+	{
+		PassPtr[0] = '\0';
+		return FALSE;
+	}
+	for(Counter = 0; Counter < Length; Counter++)
+	{
+		PassPtr[Counter] = Digits[Counter];
+	}
+	PassPtr[Counter] = '\0';
+	return TRUE;
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used to check if the two entered passwords are equal and if yes save them in the EEPROM
+ * Function used to check if the two entered passwords are equal and if yes save them in the EEPROM,
+ * the decision sent back is TRUE only once the password was written
  *
  * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the request answered with the decision
  * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
  * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
  *
@@ -353,125 +732,149 @@ void ReadEnteredPassword(uint8 * PassPtr)
  */
 
 
-void SavePassword(uint8 * PassPtr1, uint8 * PassPtr2)
+void SavePassword(const PROTOCOL_RequestType * Request, uint8 * PassPtr1, uint8 * PassPtr2)
 {
-	if (!(strcmp(PassPtr1,PassPtr2))){
+	uint8 Response = FALSE;
 
-		UART_sendByte(TRUE);
-		EEPROMStorePassword(PassPtr2);
+	/* The RAM cache is only updated once the EEPROM holds the new password, so both always agree */
+	if (!(strcmp(PassPtr1,PassPtr2)) && (EEPROMStorePassword(PassPtr2) == SUCCESS)){
+
+		Response = TRUE;
+		strcpy(g_SavedPassword, PassPtr2);	/* Write through the RAM cache */
+		g_PasswordSavedFlag = TRUE;
+		AUDIT_append(AUDIT_EVENT_PASSWORD_CHANGE, PASSWORD_USER_SLOT);
 
 	}
-	else{
-		UART_sendByte(FALSE);
-	}
+	PROTOCOL_respond(Request, &Response, 1);
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used to read and store the two entered passwords and save them.
+ * Function used to read the two entries of a new password and save it.
+ * MSG_NEW_PASSWORD holds the first entry and MSG_CONFIRM_PASSWORD the second one,
+ * the confirmation ends the change allowed by the password check whatever its result.
  *
  * INPUTS:
+ * 		PROTOCOL_RequestType * Request: the MSG_NEW_PASSWORD or MSG_CONFIRM_PASSWORD request
  * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
  * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
  *
  * OUTPUTS:N/A
  */
 
-void ChangePassword(uint8 * PassPtr1, uint8 * PassPtr2)
+void ChangePassword(const PROTOCOL_RequestType * Request, uint8 * PassPtr1, uint8 * PassPtr2)
 {
-	//UART_sendByte(ChangePasswordFn);	/* Inform MC1 about the selected choice*/
-	// error function decision byte read as password character ====================================
-	ReadEnteredPassword(PassPtr1);
-	ReadEnteredPassword(PassPtr2);
+	uint8 Response = FALSE;
 
-	SavePassword(PassPtr1, PassPtr2);
+	/* Only a user who entered the current password (or the first user) may change it, within the window */
+	if(g_ChangeAllowedFlag && Tick_isElapsed(g_ChangeAllowedTick, PASSWORD_CHANGE_WINDOW_MS))
+	{
+		g_ChangeAllowedFlag = 0;
+	}
+	if(!g_ChangeAllowedFlag)
+	{
+		PROTOCOL_respond(Request, &Response, 1);
+		return;
+	}
 
+	if(Request->type == MSG_NEW_PASSWORD)
+	{
+		Response = ReadEnteredPassword(Request->payload, Request->length, PassPtr1);
+		PROTOCOL_respond(Request, &Response, 1);
+	}
+	else
+	{
+		if(ReadEnteredPassword(Request->payload, Request->length, PassPtr2))
+		{
+			SavePassword(Request, PassPtr1, PassPtr2);
+		}
+		else
+		{
+			PROTOCOL_respond(Request, &Response, 1);	/* A corrupted entry is reported as a mismatch */
+		}
+		/* A confirmation ends the change whatever its result, another one needs the password again */
+		g_ChangeAllowedFlag = 0;
+	}
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used to compare the two passwords and set the g_PasswordCorrectFlag accordingly and inform MC1 of the decision.
+ * Function used to compare the entered password with the cached saved one, set the g_PasswordCorrectFlag
+ * accordingly and inform MC1 of the decision. The EEPROM is not accessed.
  *
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password is saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password is saved
+ * 		PROTOCOL_RequestType * Request: the request answered with the decision
+ * 		uint8 * Digits: the entered password digits in the request payload
+ * 		uint8 Length: number of digits
+ * 		uint8 * PassPtr: pointer to the string where the entered password is saved
  *
  * OUTPUTS:N/A
  */
 
-void CheckPassword(uint8 * PassPtr1, uint8 * PassPtr2)
+void CheckPassword(const PROTOCOL_RequestType * Request, const uint8 * Digits, uint8 Length, uint8 * PassPtr)
 {
-	EEPROMRetrivePassword(PassPtr1);
-	ReadEnteredPassword(PassPtr2);
-	if (!(strcmp(PassPtr1,PassPtr2))){
-		UART_sendByte(TRUE);
+	uint8 ValidEntry, Response;
+
+	ValidEntry = ReadEnteredPassword(Digits, Length, PassPtr);
+	if (ValidEntry && g_PasswordSavedFlag && !(strcmp(g_SavedPassword,PassPtr))){
 		g_PasswordCorrectFlag=1;
 	}
 	else{
-		UART_sendByte(FALSE);
 		g_PasswordCorrectFlag=0;
 	}
+	Response = g_PasswordCorrectFlag;
+	PROTOCOL_respond(Request, &Response, 1);
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used for checking the flag in the EEPROM to determine if previous password is saved at first use
+ * Function used for checking if a previous password is saved at first use
  * Used after power cuts to prevent creating a new password
 
  * INPUTS:
- * 		uint8 * PassPtr1: pointer to the string where the first entered password will be saved
- * 		uint8 * PassPtr2: pointer to the string where the second entered password will be saved
+ * 		PROTOCOL_RequestType * Request: the MSG_PASSWORD_STATUS request
  *
  * OUTPUTS:	N/A
  */
 
-void CheckForPreviouslySavedPassword(uint8 * PassPtr1, uint8 * PassPtr2)
+void CheckForPreviouslySavedPassword(const PROTOCOL_RequestType * Request)
 {
-	uint8 FirstSystemPassword_flag;
-	EEPROM_readByte( 0x0311, &FirstSystemPassword_flag ); /* Read current character in the external EEPROM*/
-	if (FirstSystemPassword_flag==1)
+	uint8 Response;
+
+	/* The password record was validated in the RAM cache at boot */
+	if (g_PasswordSavedFlag)
 	{
-		EEPROMRetrivePassword(PassPtr1);
-		UART_sendByte(TRUE);
+		Response = TRUE;
+		PROTOCOL_respond(Request, &Response, 1);
 	}
 	else
 	{
-		EEPROM_writeByte( 0x0311 , 1); /* Write current character in the external EEPROM */
-		_delay_ms(10);
-		UART_sendByte(FALSE);
-		UART_recieveByte(); //dummy
-		ChangePassword(PassPtr1, PassPtr2);
+		g_ChangeAllowedFlag = 1;	/* First use, MC1 sets the password next */
+		g_ChangeAllowedTick = Tick_getMs();
+		Response = FALSE;
+		PROTOCOL_respond(Request, &Response, 1);
 	}
 }
-/********************************************************************************************************/
-void InformMC1(uint8 SelectedFn)
-{
-	UART_sendByte(SelectedFn);
-}
-
 /********************************************************************************************************/
 
 /* Description:
  * Function used for saving the new password in the EEPROM
+ * The password is padded with nulls to PASSWORD_MAX_LENGTH bytes and written in the next slot of the ring
  *
  * INPUTS:
  * 		uint8 * PassPtr: pointer to the string where the password is saved
  *
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8: SUCCESS or ERROR if the EEPROM could not be written, the previous password is kept
  */
 
-void EEPROMStorePassword(uint8 * PassPtr)
+uint8 EEPROMStorePassword(uint8 * PassPtr)
 {
-	uint8 Character ,Counter= 0;
-	uint16 FirstAddress = 0x0312;
-	do
-	{
-		Character = PassPtr[Counter];
-		EEPROM_writeByte( FirstAddress + Counter , Character); /* Write current character in the external EEPROM */
-		_delay_ms(10);
-		Counter++;
-	}
-	while(Character != NULL_PTR);
+	uint8 Record[PASSWORD_MAX_LENGTH];
+
+	/* A password of PASSWORD_MAX_LENGTH digits is stored without its null */
+	strncpy((char *)Record, (const char *)PassPtr, PASSWORD_MAX_LENGTH);
+	return EEPROM_ringWrite(&g_PasswordRing, Record);
 }
 /********************************************************************************************************/
 
@@ -479,77 +882,125 @@ void EEPROMStorePassword(uint8 * PassPtr)
  * Function used for reading the saved password in the EEPROM
  *
  * INPUTS:
- * 		uint8 * PassPtr: pointer to the string where the password will be saved
+ * 		uint8 * PassPtr: pointer to the string (PASSWORD_MAX_LENGTH + 1 bytes) where the password will be saved
+ *
+ * OUTPUTS:
+ * 		uint8: SUCCESS or ERROR if the EEPROM could not be read
+ */
+
+uint8 EEPROMRetrivePassword(uint8 * PassPtr)
+{
+	uint8 Status;
+
+	/* The whole newest record in one sequential read, checked against its CRC, a full length password has no null */
+	Status = EEPROM_ringRead(&g_PasswordRing, PassPtr);
+	PassPtr[PASSWORD_MAX_LENGTH] = '\0';
+	return Status;
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for loading the saved password in the RAM cache at boot:
+ *  Find the newest password record in the ring of slots and read it
+ *  Keep the password only if the record is a valid password (digits only)
+ *
+ * INPUTS:	N/A
  *
  * OUTPUTS:	N/A
  */
 
-void EEPROMRetrivePassword(uint8 * PassPtr)
+void LoadPasswordCache(void)
 {
-	uint8 Counter= 0;
-	uint16 FirstAddress = 0x0312;
-	do
+	g_PasswordSavedFlag = FALSE;
+	g_SavedPassword[0] = '\0';
+
+	/* Only the sequence numbers are read to find the newest slot, no record means first use */
+	if(EEPROM_ringInit(&g_PasswordRing) == ERROR)
 	{
-		//_delay_ms(10);
-		EEPROM_readByte( FirstAddress + Counter , PassPtr + Counter ); /* Write current character in the external EEPROM */
-		Counter++;
+		return;
 	}
-	while( PassPtr[Counter-1] != NULL_PTR);
-	//PassPtr[Counter] = NULL_PTR;
+	if(EEPROMRetrivePassword(g_SavedPassword) == ERROR)
+	{
+		g_SavedPassword[0] = '\0';
+		return;
+	}
+	if(!ValidPasswordRecord(g_SavedPassword))
+	{
+		/* Erased or corrupted record, no password can match it */
+		g_SavedPassword[0] = '\0';
+		return;
+	}
+	g_PasswordSavedFlag = TRUE;
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used for:
- *  Interrupt Service Routine for timer0 compare mode
- *  Set g_FinshedCounting flag to 1 every 1 second
+ * Function used for checking that a password record read from the EEPROM holds a valid password
  *
- * INPUTS:	N/A
+ * INPUTS:
+ * 		uint8 * Record: the null terminated record
  *
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8: TRUE if the record only holds digits
  */
 
-void TickCounter(void)
+uint8 ValidPasswordRecord(const uint8 * Record)
 {
-	g_tick++;
-	if(g_tick == NUMBER_OF_COMPARE_MTACHES_PER_SECOND )
+	uint8 Counter;
+
+	for(Counter = 0; Record[Counter] != '\0'; Counter++)
 	{
-		g_FinshedCounting=1;
-		g_tick = 0; //clear the tick counter again to count a new 0.5 second
+		if((Record[Counter] < '0') || (Record[Counter] > '9'))
+		{
+			return FALSE;
+		}
 	}
+	return TRUE;
 }
 /********************************************************************************************************/
 
 /* Description:
- * Function used for:
- *  Initializing Timer0 with the desired values
- *  Loop until reaching the desired number of delayed seconds
+ * Function used for answering MSG_AUDIT_DUMP with the number of entries in the audit log
+ * and up to AUDIT_DUMP_MAX_ENTRIES entries from the requested index on,
+ * or with an empty response unless the password was just checked for UNLOCK_AUDIT_LOG
  *
  * INPUTS:
- * 		uint8 Seconds: Number of desired seconds to delay
+ * 		PROTOCOL_RequestType * Request: the MSG_AUDIT_DUMP request
  *
  * OUTPUTS:	N/A
  */
-void CountByTimer1(uint8 Seconds)
+
+void AuditDump(const PROTOCOL_RequestType * Request)
 {
-	Timer1_DeInit();
-	Timer1_ConfigType Timer1_Structure={COMPARE,F_CPU_1024,0,250};
-	Timer1_init(&Timer1_Structure);
-	Timer1_setCallBack(TickCounter);
-	uint8 SecondsCounter=0;
-	while(1)
+	uint8 Response[1 + AUDIT_DUMP_MAX_ENTRIES * AUDIT_DUMP_ENTRY_SIZE];
+	uint8 Index, Count;
+
+	/* Every dump allowed keeps the window open while MC1 pages through the log */
+	if(g_AuditAllowedFlag && Tick_isElapsed(g_AuditAllowedTick, AUDIT_DUMP_WINDOW_MS))
 	{
+		g_AuditAllowedFlag = 0;
+	}
+	if(!g_AuditAllowedFlag)
+	{
+		PROTOCOL_respond(Request, NULL_PTR, 0);
+		return;
+	}
+	g_AuditAllowedTick = Tick_getMs();
 
-		if(g_FinshedCounting==1){
-			SecondsCounter++;
-			g_FinshedCounting=0;
-		}
+	Response[0] = AUDIT_getCount();
+	Index = (Request->length >= 1) ? Request->payload[0] : Response[0];
 
-		if(SecondsCounter==Seconds){
-			SecondsCounter=0;
-			Timer1_DeInit();
-			return;
-		}
+	/* Entries past the end of the log are left out, the master reads on until it gets none */
+	Count = (Index < Response[0]) ? (Response[0] - Index) : 0;
+	if(Count > AUDIT_DUMP_MAX_ENTRIES)
+	{
+		Count = AUDIT_DUMP_MAX_ENTRIES;
+	}
+	if((Count != 0) && (AUDIT_read(Index, &Response[1], Count) == ERROR))
+	{
+		Count = 0;
 	}
+	PROTOCOL_respond(Request, Response, 1 + Count * AUDIT_DUMP_ENTRY_SIZE);
 }
+/********************************************************************************************************/
 
@@ -8,8 +8,15 @@ C_SRCS += \
 ../ControlECU.c \
 ../MOTOR_DC.c \
 ../PWM.c \
+../audit_log.c \
+../door.c \
 ../external_eeprom.c \
+../frame.c \
 ../gpio.c \
+../kv_store.c \
+../link.c \
+../protocol.c \
+../scheduler.c \
 ../timer.c \
 ../twi.c \
 ../uart.c 
@@ -19,8 +26,15 @@ OBJS += \
 ./ControlECU.o \
 ./MOTOR_DC.o \
 ./PWM.o \
+./audit_log.o \
+./door.o \
 ./external_eeprom.o \
+./frame.o \
 ./gpio.o \
+./kv_store.o \
+./link.o \
+./protocol.o \
+./scheduler.o \
 ./timer.o \
 ./twi.o \
 ./uart.o 
@@ -30,8 +44,15 @@ C_DEPS += \
 ./ControlECU.d \
 ./MOTOR_DC.d \
 ./PWM.d \
+./audit_log.d \
+./door.d \
 ./external_eeprom.d \
+./frame.d \
 ./gpio.d \
+./kv_store.d \
+./link.d \
+./protocol.d \
+./scheduler.d \
 ./timer.d \
 ./twi.d \
 ./uart.d 
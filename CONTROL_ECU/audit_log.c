@@ -0,0 +1,254 @@
+/******************************************************************************
+ *
+ * Module: AUDIT_LOG
+ *
+ * File Name: audit_log.c
+ *
+ * Description: Source file for the access audit log kept in the external EEPROM.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "audit_log.h"
+#include "external_eeprom.h"
+#include "timer.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Entry written by the next append, number of entries and next sequence number */
+static uint8 g_next;
+static uint8 g_count;
+static uint16 g_sequence;
+
+/* Entries staged in the RAM copy of the page being filled: the first one, their number
+ * and the tick when the first was staged */
+static uint8 g_staging[EEPROM_PAGE_SIZE];
+static uint8 g_stagedEntry;
+static uint8 g_stagedCount = 0;
+static uint32 g_stagedTick;
+
+/* TRUE once AUDIT_init() found the newest entry */
+static bool g_ready = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Address of an entry of the circular array.
+ */
+static uint16 AUDIT_entryAddress(uint8 entry)
+{
+	return AUDIT_BASE_ADDRESS + (uint16)entry * AUDIT_ENTRY_SIZE;
+}
+
+/*
+ * Description :
+ * Read the sequence number and the event of an entry, *valid is FALSE for a free entry.
+ */
+static uint8 AUDIT_readHeader(uint8 entry, uint16 *sequence, bool *valid)
+{
+	uint8 header[3];
+
+	if(EEPROM_readBlock(AUDIT_entryAddress(entry), header, 3) == ERROR)
+	{
+		return ERROR;
+	}
+	*sequence = (uint16)header[0] | ((uint16)header[1] << 8);
+	*valid = (header[2] != AUDIT_ERASED_EVENT);
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Find the newest entry at boot with a binary search on the sequence numbers:
+ * from the first entry on they go up by one until the newest entry, O(log n) reads.
+ * Returns ERROR if the EEPROM could not be read, the log is then unusable.
+ */
+uint8 AUDIT_init(void)
+{
+	uint16 first, sequence;
+	uint8 low, high, middle;
+	bool valid;
+
+	g_ready = FALSE;
+	g_stagedCount = 0;
+	g_next = 0;
+	g_count = 0;
+	g_sequence = 0;
+
+	if(AUDIT_readHeader(0, &first, &valid) == ERROR)
+	{
+		return ERROR;
+	}
+	if(valid)
+	{
+		/* Entry low holds first + low, entry high does not (or is past the end): after the
+		 * newest entry come free entries or older ones from the previous turn */
+		low = 0;
+		high = AUDIT_MAX_ENTRIES;
+		while(high - low > 1)
+		{
+			middle = low + (high - low) / 2;
+			if(AUDIT_readHeader(middle, &sequence, &valid) == ERROR)
+			{
+				return ERROR;
+			}
+			if(valid && (sequence == (uint16)(first + middle)))
+			{
+				low = middle;
+			}
+			else
+			{
+				high = middle;
+			}
+		}
+
+		g_next = (low + 1) % AUDIT_MAX_ENTRIES;
+		g_sequence = first + low + 1;
+		g_count = low + 1;
+		if(g_next != 0)
+		{
+			/* The entry after the newest one is free unless the log went round already */
+			if(AUDIT_readHeader(g_next, &sequence, &valid) == ERROR)
+			{
+				return ERROR;
+			}
+			if(valid)
+			{
+				g_count = AUDIT_MAX_ENTRIES;
+			}
+		}
+	}
+	g_ready = TRUE;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Add an entry with the next sequence number and the current time, overwriting the oldest
+ * one if the log is full. The entry is staged, it is written with the rest of its page.
+ * Returns ERROR if the log is unusable or a full page could not be written.
+ */
+uint8 AUDIT_append(uint8 event, uint8 user)
+{
+	uint8 *entry;
+	uint32 now = Tick_getMs();
+	uint32 timestamp = now / 1000;
+
+	if(!g_ready)
+	{
+		return ERROR;
+	}
+
+	if(g_stagedCount == 0)
+	{
+		/* The first entry staged may be in the middle of its page after a boot */
+		g_stagedEntry = g_next;
+		g_stagedTick = now;
+	}
+	entry = &g_staging[g_stagedCount * AUDIT_ENTRY_SIZE];
+	g_stagedCount++;
+
+	entry[0] = (uint8)(g_sequence);
+	entry[1] = (uint8)(g_sequence >> 8);
+	entry[2] = event;
+	entry[3] = user;
+	entry[4] = (uint8)(timestamp);
+	entry[5] = (uint8)(timestamp >> 8);
+	entry[6] = (uint8)(timestamp >> 16);
+	entry[7] = (uint8)(timestamp >> 24);
+
+	g_next = (g_next + 1) % AUDIT_MAX_ENTRIES;
+	g_sequence++;
+	if(g_count < AUDIT_MAX_ENTRIES)
+	{
+		g_count++;
+	}
+
+	/* The log is a whole number of pages, the next entry starts a page once this one is full */
+	if((g_next % (EEPROM_PAGE_SIZE / AUDIT_ENTRY_SIZE)) == 0)
+	{
+		return AUDIT_flush();
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Write the staged entries now, in one page write. Call it on a power fail warning.
+ * Returns ERROR if they could not be written, they are dropped.
+ */
+uint8 AUDIT_flush(void)
+{
+	uint8 count = g_stagedCount;
+
+	if(count == 0)
+	{
+		return SUCCESS;
+	}
+	g_stagedCount = 0;
+	return EEPROM_writeBlock(AUDIT_entryAddress(g_stagedEntry), g_staging, (uint16)count * AUDIT_ENTRY_SIZE);
+}
+
+/*
+ * Description :
+ * Write the staged entries if the oldest one was staged AUDIT_FLUSH_DELAY_MS ago.
+ * Call it periodically, it bounds the time an entry can be lost by a power loss.
+ */
+uint8 AUDIT_flushExpired(void)
+{
+	if((g_stagedCount == 0) || !Tick_isElapsed(g_stagedTick, AUDIT_FLUSH_DELAY_MS))
+	{
+		return SUCCESS;
+	}
+	return AUDIT_flush();
+}
+
+/*
+ * Description :
+ * Return the number of entries in the log.
+ */
+uint8 AUDIT_getCount(void)
+{
+	return g_count;
+}
+
+/*
+ * Description :
+ * Read count entries (AUDIT_ENTRY_SIZE bytes each, as stored) from the index-th oldest on
+ * in one burst per contiguous part of the circular array, the staged entries are written first.
+ * Returns ERROR if they are not all in the log or the EEPROM could not be read.
+ */
+uint8 AUDIT_read(uint8 index, uint8 *entries, uint8 count)
+{
+	uint8 entry, chunk;
+
+	if(!g_ready || ((uint16)index + count > g_count) || (AUDIT_flush() == ERROR))
+	{
+		return ERROR;
+	}
+
+	/* The oldest entry is the next one to be overwritten once the log is full */
+	entry = (uint8)(((uint16)g_next + AUDIT_MAX_ENTRIES - g_count + index) % AUDIT_MAX_ENTRIES);
+	while(count != 0)
+	{
+		chunk = AUDIT_MAX_ENTRIES - entry;
+		if(chunk > count)
+		{
+			chunk = count;
+		}
+		if(EEPROM_readBlock(AUDIT_entryAddress(entry), entries, (uint16)chunk * AUDIT_ENTRY_SIZE) == ERROR)
+		{
+			return ERROR;
+		}
+		entries += (uint16)chunk * AUDIT_ENTRY_SIZE;
+		count -= chunk;
+		entry = 0;
+	}
+	return SUCCESS;
+}
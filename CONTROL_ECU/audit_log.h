@@ -0,0 +1,94 @@
+/******************************************************************************
+ *
+ * Module: AUDIT_LOG
+ *
+ * File Name: audit_log.h
+ *
+ * Description: Header file for the access audit log kept in the external EEPROM.
+ *
+ * The log is a circular array of AUDIT_MAX_ENTRIES fixed size entries
+ *  +----------+-------+------+-----------+
+ *  | SEQUENCE | EVENT | USER | TIMESTAMP |
+ *  +----------+-------+------+-----------+
+ * SEQUENCE (16 bits) and TIMESTAMP (32 bits, seconds since boot) are little endian.
+ * The entries are written in order with consecutive sequence numbers, the oldest one
+ * is overwritten when the log is full. An entry never crosses a page. EVENT 0xFF (erased)
+ * marks a free entry.
+ * Appends are staged in a RAM copy of the page being filled and the page is written once
+ * (group commit) when it is full, when the oldest staged entry is AUDIT_FLUSH_DELAY_MS old
+ * (AUDIT_flushExpired() called periodically) or on AUDIT_flush(). A power loss loses at most
+ * the entries of one page staged for AUDIT_FLUSH_DELAY_MS plus the period of the caller.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef AUDIT_LOG_H_
+#define AUDIT_LOG_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* EEPROM area of the log, page aligned */
+#define AUDIT_BASE_ADDRESS 0x0600
+#define AUDIT_ENTRY_SIZE 8
+#define AUDIT_MAX_ENTRIES 64
+
+/* Event of an entry never written */
+#define AUDIT_ERASED_EVENT 0xFF
+
+/* Longest time an entry stays staged in RAM once AUDIT_flushExpired() is called */
+#define AUDIT_FLUSH_DELAY_MS 500
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Find the newest entry at boot with a binary search on the sequence numbers:
+ * from the first entry on they go up by one until the newest entry, O(log n) reads.
+ * Returns ERROR if the EEPROM could not be read, the log is then unusable.
+ */
+uint8 AUDIT_init(void);
+
+/*
+ * Description :
+ * Add an entry with the next sequence number and the current time, overwriting the oldest
+ * one if the log is full. The entry is staged, it is written with the rest of its page.
+ * Returns ERROR if the log is unusable or a full page could not be written.
+ */
+uint8 AUDIT_append(uint8 event, uint8 user);
+
+/*
+ * Description :
+ * Write the staged entries now, in one page write. Call it on a power fail warning.
+ * Returns ERROR if they could not be written, they are dropped.
+ */
+uint8 AUDIT_flush(void);
+
+/*
+ * Description :
+ * Write the staged entries if the oldest one was staged AUDIT_FLUSH_DELAY_MS ago.
+ * Call it periodically, it bounds the time an entry can be lost by a power loss.
+ */
+uint8 AUDIT_flushExpired(void);
+
+/*
+ * Description :
+ * Return the number of entries in the log.
+ */
+uint8 AUDIT_getCount(void);
+
+/*
+ * Description :
+ * Read count entries (AUDIT_ENTRY_SIZE bytes each, as stored) from the index-th oldest on
+ * in one burst per contiguous part of the circular array, the staged entries are written first.
+ * Returns ERROR if they are not all in the log or the EEPROM could not be read.
+ */
+uint8 AUDIT_read(uint8 index, uint8 *entries, uint8 count);
+
+#endif /* AUDIT_LOG_H_ */
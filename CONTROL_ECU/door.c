@@ -0,0 +1,154 @@
+/******************************************************************************
+ *
+ * Module: DOOR
+ *
+ * File Name: door.c
+ *
+ * Description: Source file for the door actuation state machine.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "door.h"
+#include "MOTOR_DC.h"
+#include "timer.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static DOOR_PhaseType g_phase = DOOR_LOCKED;
+
+/* Software timer measuring the current phase */
+static uint8 g_phaseTimer = SOFT_TIMER_INVALID;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Drive the motor for a phase and start measuring its duration, Duration_ms is ignored
+ * when the door is locked.
+ */
+static void DOOR_enterPhase(DOOR_PhaseType Phase, uint32 Duration_ms)
+{
+	g_phase = Phase;
+	switch(Phase)
+	{
+	case DOOR_OPENING:
+		DcMotor_Rotate(CLOCKWISE, DOOR_MOTOR_SPEED);
+		SoftTimer_start(g_phaseTimer, Duration_ms, SOFT_TIMER_ONE_SHOT);
+		break;
+
+	case DOOR_HELD:
+		DcMotor_Rotate(STOP, 0);
+		SoftTimer_start(g_phaseTimer, Duration_ms, SOFT_TIMER_ONE_SHOT);
+		break;
+
+	case DOOR_CLOSING:
+		DcMotor_Rotate(ANTI_CLOCKWISE, DOOR_MOTOR_SPEED);
+		SoftTimer_start(g_phaseTimer, Duration_ms, SOFT_TIMER_ONE_SHOT);
+		break;
+
+	default:
+		DcMotor_Rotate(STOP, 0);
+		SoftTimer_stop(g_phaseTimer);
+		break;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the door locked with the motor stopped. aCallBack_ptr is called from the
+ * tick interrupt at the end of every phase. Needs the system tick (Tick_init) and the motor driver.
+ */
+void DOOR_init(void (*aCallBack_ptr)(void))
+{
+	if(g_phaseTimer == SOFT_TIMER_INVALID)
+	{
+		g_phaseTimer = SoftTimer_create(aCallBack_ptr);
+	}
+	DOOR_enterPhase(DOOR_LOCKED, 0);
+}
+
+/*
+ * Description :
+ * Open the door. A request while the door is held restarts the hold time and a request
+ * while it is closing opens it again, only as far as it already closed.
+ */
+void DOOR_open(void)
+{
+	uint32 Closed_ms;
+
+	switch(g_phase)
+	{
+	case DOOR_LOCKED:
+		DOOR_enterPhase(DOOR_OPENING, DOOR_OPENING_TIME_MS);
+		break;
+
+	case DOOR_CLOSING:
+		/* Driving it open for the full time would run the motor against its end stop */
+		Closed_ms = DOOR_CLOSING_TIME_MS - SoftTimer_getRemainingMs(g_phaseTimer);
+		DOOR_enterPhase(DOOR_OPENING, (Closed_ms * DOOR_OPENING_TIME_MS) / DOOR_CLOSING_TIME_MS);
+		break;
+
+	case DOOR_HELD:
+		DOOR_enterPhase(DOOR_HELD, DOOR_HOLD_TIME_MS);
+		break;
+
+	default:
+		/* Already opening */
+		break;
+	}
+}
+
+/*
+ * Description :
+ * Move to the next phase once the current one is over, nothing to do otherwise.
+ */
+void DOOR_update(void)
+{
+	if((g_phase == DOOR_LOCKED) || SoftTimer_isRunning(g_phaseTimer))
+	{
+		return;
+	}
+
+	switch(g_phase)
+	{
+	case DOOR_OPENING:
+		DOOR_enterPhase(DOOR_HELD, DOOR_HOLD_TIME_MS);
+		break;
+
+	case DOOR_HELD:
+		DOOR_enterPhase(DOOR_CLOSING, DOOR_CLOSING_TIME_MS);
+		break;
+
+	default:
+		DOOR_enterPhase(DOOR_LOCKED, 0);
+		break;
+	}
+}
+
+/*
+ * Description :
+ * Return the current phase of the sequence.
+ */
+DOOR_PhaseType DOOR_getPhase(void)
+{
+	return g_phase;
+}
+
+/*
+ * Description :
+ * Return the milliseconds left in the current phase, 0 when the door is locked.
+ */
+uint32 DOOR_getRemainingMs(void)
+{
+	return (g_phase == DOOR_LOCKED) ? 0 : SoftTimer_getRemainingMs(g_phaseTimer);
+}
@@ -0,0 +1,79 @@
+/******************************************************************************
+ *
+ * Module: DOOR
+ *
+ * File Name: door.h
+ *
+ * Description: Header file for the door actuation state machine.
+ *
+ * DOOR_open() starts the sequence opening -> held -> closing -> locked without
+ * blocking. A software timer measures every phase; when it expires the call back
+ * given to DOOR_init() runs from the tick interrupt and the application must then
+ * call DOOR_update() (from its main loop or a task) to move the motor to the next phase.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef DOOR_H_
+#define DOOR_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Duration of every phase of the sequence */
+#define DOOR_OPENING_TIME_MS 15000
+#define DOOR_HOLD_TIME_MS    10000
+#define DOOR_CLOSING_TIME_MS 15000
+
+/* Motor speed (percent) while the door moves */
+#define DOOR_MOTOR_SPEED     100
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	DOOR_LOCKED,DOOR_OPENING,DOOR_HELD,DOOR_CLOSING
+}DOOR_PhaseType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the door locked with the motor stopped. aCallBack_ptr is called from the
+ * tick interrupt at the end of every phase. Needs the system tick (Tick_init) and the motor driver.
+ */
+void DOOR_init(void (*aCallBack_ptr)(void));
+
+/*
+ * Description :
+ * Open the door. A request while the door is held restarts the hold time and a request
+ * while it is closing opens it again, only as far as it already closed.
+ */
+void DOOR_open(void);
+
+/*
+ * Description :
+ * Move to the next phase once the current one is over, nothing to do otherwise.
+ */
+void DOOR_update(void);
+
+/*
+ * Description :
+ * Return the current phase of the sequence.
+ */
+DOOR_PhaseType DOOR_getPhase(void);
+
+/*
+ * Description :
+ * Return the milliseconds left in the current phase, 0 when the door is locked.
+ */
+uint32 DOOR_getRemainingMs(void);
+
+#endif /* DOOR_H_ */
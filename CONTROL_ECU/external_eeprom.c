@@ -11,72 +11,395 @@
  *******************************************************************************/
 #include "external_eeprom.h"
 #include "twi.h"
+#include "timer.h"
+#include "frame.h"
+
+/* TRUE from a write until the device acknowledges again, and the tick of that write */
+static bool g_writePending = FALSE;
+static uint32 g_writeTick;
+
+/*
+ * Description :
+ * Check once whether the device acknowledges its address (start, device address + W, stop).
+ */
+static bool EEPROM_acknowledges(void)
+{
+	TWI_TransactionType transaction;
+
+	transaction.slaveAddress = 0xA0;
+	transaction.writeData = NULL_PTR;
+	transaction.writeLength = 0;
+	transaction.readData = NULL_PTR;
+	transaction.readLength = 0;
+	transaction.callBack = NULL_PTR;
+	transaction.status = TWI_IDLE;
+
+	return TWI_execute(&transaction) == TWI_DONE;
+}
+
+/*
+ * Description :
+ * Run one transaction with the memory at u16addr: the address, writeLength bytes,
+ * then readLength bytes after a repeated start. A failed transaction (no acknowledge,
+ * bus error or timeout, the bus is already recovered by the TWI driver) is tried
+ * again up to EEPROM_MAX_RETRIES times. A write cycle still running is waited for first
+ * and a write starts a new one.
+ */
+static uint8 EEPROM_transfer(uint16 u16addr, const uint8 *writeData, uint8 writeLength,
+		uint8 *readData, uint8 readLength)
+{
+	TWI_TransactionType transaction;
+	uint8 buffer[1 + EEPROM_PAGE_SIZE];
+	uint8 i, attempt;
+
+	if(writeLength > EEPROM_PAGE_SIZE)
+	{
+		return ERROR;
+	}
+
+	/* The word address is sent first, the data follows in the same write */
+	buffer[0] = (uint8)(u16addr);
+	for(i = 0; i < writeLength; i++)
+	{
+		buffer[1 + i] = writeData[i];
+	}
+
+	/* The device address holds the A8 A9 A10 address bits of the memory location */
+	transaction.slaveAddress = (uint8)(0xA0 | ((u16addr & 0x0700)>>7));
+	transaction.writeData = buffer;
+	transaction.writeLength = 1 + writeLength;
+	transaction.readData = readData;
+	transaction.readLength = readLength;
+	transaction.callBack = NULL_PTR;
+	transaction.status = TWI_IDLE;
+
+	EEPROM_waitWriteDone();
+
+	for(attempt = 0; attempt <= EEPROM_MAX_RETRIES; attempt++)
+	{
+		if(TWI_execute(&transaction) == TWI_DONE)
+		{
+			if(writeLength != 0)
+			{
+				g_writePending = TRUE;
+				g_writeTick = Tick_getMs();
+			}
+			return SUCCESS;
+		}
+	}
+	return ERROR;
+}
 
 uint8 EEPROM_writeByte(uint16 u16addr, uint8 u8data)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR; 
-		 
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-		
-    /* write byte to eeprom */
-    TWI_writeByte(u8data);
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
-	
-    return SUCCESS;
+	/* Start, device address + W, memory address, data byte, stop */
+	return EEPROM_transfer(u16addr, &u8data, 1, NULL_PTR, 0);
 }
 
 uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
 {
-	/* Send the Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=0 (write) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7)));
-    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
-        return ERROR;
-		
-    /* Send the required memory location address */
-    TWI_writeByte((uint8)(u16addr));
-    if (TWI_getStatus() != TWI_MT_DATA_ACK)
-        return ERROR;
-		
-    /* Send the Repeated Start Bit */
-    TWI_start();
-    if (TWI_getStatus() != TWI_REP_START)
-        return ERROR;
-		
-    /* Send the device address, we need to get A8 A9 A10 address bits from the
-     * memory location address and R/W=1 (Read) */
-    TWI_writeByte((uint8)((0xA0) | ((u16addr & 0x0700)>>7) | 1));
-    if (TWI_getStatus() != TWI_MT_SLA_R_ACK)
-        return ERROR;
-
-    /* Read Byte from Memory without send ACK */
-    *u8data = TWI_readByteWithNACK();
-    if (TWI_getStatus() != TWI_MR_DATA_NACK)
-        return ERROR;
-
-    /* Send the Stop Bit */
-    TWI_stop();
-
-    return SUCCESS;
+	/* Start, device address + W, memory address, repeated start, device address + R, one byte, stop */
+	return EEPROM_transfer(u16addr, NULL_PTR, 0, u8data, 1);
+}
+
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length)
+{
+	uint8 chunk;
+
+	while(length != 0)
+	{
+		/* Bytes left in the page of u16addr, the device would wrap around inside the page */
+		chunk = EEPROM_PAGE_SIZE - (u16addr % EEPROM_PAGE_SIZE);
+		if(chunk > length)
+		{
+			chunk = length;
+		}
+
+		/* The write of the previous page is waited for by acknowledge polling */
+		if(EEPROM_transfer(u16addr, data, chunk, NULL_PTR, 0) == ERROR)
+		{
+			return ERROR;
+		}
+
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+	return SUCCESS;
+}
+
+uint8 EEPROM_updateBlock(uint16 u16addr, const uint8 *data, uint16 length)
+{
+	uint8 current[EEPROM_PAGE_SIZE];
+	uint8 chunk, first, last;
+
+	while(length != 0)
+	{
+		chunk = EEPROM_PAGE_SIZE - (u16addr % EEPROM_PAGE_SIZE);
+		if(chunk > length)
+		{
+			chunk = length;
+		}
+
+		if(EEPROM_transfer(u16addr, NULL_PTR, 0, current, chunk) == ERROR)
+		{
+			return ERROR;
+		}
+
+		/* Smallest span holding all the different bytes, one page write at most */
+		for(first = 0; (first < chunk) && (current[first] == data[first]); first++);
+		if(first < chunk)
+		{
+			for(last = chunk - 1; current[last] == data[last]; last--);
+			if(EEPROM_transfer(u16addr + first, data + first, last - first + 1, NULL_PTR, 0) == ERROR)
+			{
+				return ERROR;
+			}
+		}
+
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+	return SUCCESS;
+}
+
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length)
+{
+	uint8 chunk;
+
+	while(length != 0)
+	{
+		/* A transaction reads at most 255 bytes, the device keeps counting across pages */
+		chunk = (length > 0xFF) ? 0xFF : (uint8)length;
+
+		if(EEPROM_transfer(u16addr, NULL_PTR, 0, data, chunk) == ERROR)
+		{
+			return ERROR;
+		}
+
+		u16addr += chunk;
+		data += chunk;
+		length -= chunk;
+	}
+	return SUCCESS;
+}
+
+bool EEPROM_isWriteBusy(void)
+{
+	if(g_writePending && EEPROM_acknowledges())
+	{
+		g_writePending = FALSE;
+	}
+	return g_writePending;
+}
+
+uint8 EEPROM_waitWriteDone(void)
+{
+	while(EEPROM_isWriteBusy())
+	{
+		/* One more tick than the worst case, the tick may have been just about to change */
+		if(Tick_isElapsed(g_writeTick, EEPROM_WRITE_CYCLE_MS + 1))
+		{
+			g_writePending = FALSE;
+			return ERROR;
+		}
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Address of the header of a slot of the ring, the slots are whole pages.
+ */
+static uint16 EEPROM_ringAddress(const EEPROM_RingType *ring, uint8 slot)
+{
+	uint16 slotSize;
+
+	slotSize = ((EEPROM_RING_HEADER_SIZE + ring->dataSize + EEPROM_PAGE_SIZE - 1) / EEPROM_PAGE_SIZE) * EEPROM_PAGE_SIZE;
+	return ring->baseAddress + slot * slotSize;
+}
+
+/*
+ * Description :
+ * CRC-8 of a slot: the sequence number and the data, the same CRC as the UART frames.
+ */
+static uint8 EEPROM_ringCrc(const EEPROM_RingType *ring, const uint8 *slot)
+{
+	uint8 crc = 0;
+	uint8 i;
+
+	crc = FRAME_crc8(crc, slot[0]);
+	crc = FRAME_crc8(crc, slot[1]);
+	for(i = 0; i < ring->dataSize; i++)
+	{
+		crc = FRAME_crc8(crc, slot[EEPROM_RING_HEADER_SIZE + i]);
+	}
+	return crc;
+}
+
+/*
+ * Description :
+ * Read the header of every slot and return the newest committed slot, not in the rejected
+ * mask, in ring->current (EEPROM_RING_EMPTY if none) with its sequence number.
+ */
+static uint8 EEPROM_ringFindNewest(EEPROM_RingType *ring, uint32 rejected)
+{
+	uint8 header[EEPROM_RING_HEADER_SIZE];
+	uint16 sequence;
+	uint8 slot;
+
+	ring->current = EEPROM_RING_EMPTY;
+	ring->sequence = 0;
+
+	for(slot = 0; slot < ring->slotCount; slot++)
+	{
+		if(rejected & ((uint32)1 << slot))
+		{
+			continue;
+		}
+		if(EEPROM_readBlock(EEPROM_ringAddress(ring, slot), header, EEPROM_RING_HEADER_SIZE) == ERROR)
+		{
+			return ERROR;
+		}
+		sequence = (uint16)header[0] | ((uint16)header[1] << 8);
+		if((sequence == EEPROM_RING_ERASED) || (header[EEPROM_RING_COMMIT_OFFSET] != EEPROM_RING_COMMITTED))
+		{
+			continue;
+		}
+		/* Serial order: the numbers wrap around, a record is newer if it is less than half the range ahead */
+		if((ring->current == EEPROM_RING_EMPTY) || ((sint16)(sequence - ring->sequence) > 0))
+		{
+			ring->current = slot;
+			ring->sequence = sequence;
+		}
+	}
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Return TRUE if slot (EEPROM_RING_HEADER_SIZE + dataSize bytes read from the slot of
+ * the newest record) is still that record: committed, same sequence number and CRC.
+ */
+static bool EEPROM_ringCheck(const EEPROM_RingType *ring, const uint8 *slot)
+{
+	uint16 sequence = (uint16)slot[0] | ((uint16)slot[1] << 8);
+
+	return (slot[EEPROM_RING_COMMIT_OFFSET] == EEPROM_RING_COMMITTED) && (sequence == ring->sequence) &&
+			(slot[EEPROM_RING_CRC_OFFSET] == EEPROM_ringCrc(ring, slot));
+}
+
+uint8 EEPROM_ringInit(EEPROM_RingType *ring)
+{
+	uint8 slot[EEPROM_RING_HEADER_SIZE + EEPROM_RING_MAX_DATA_SIZE];
+	uint32 rejected = 0;
+
+	if((ring->dataSize > EEPROM_RING_MAX_DATA_SIZE) || (ring->slotCount > EEPROM_RING_MAX_SLOTS))
+	{
+		ring->current = EEPROM_RING_EMPTY;
+		return ERROR;
+	}
+
+	/* Normally one pass over the headers and one CRC check, only the slot being written
+	 * at a power loss can be damaged so a second pass is rare */
+	for(;;)
+	{
+		if(EEPROM_ringFindNewest(ring, rejected) == ERROR)
+		{
+			ring->current = EEPROM_RING_EMPTY;
+			return ERROR;
+		}
+		if(ring->current == EEPROM_RING_EMPTY)
+		{
+			return SUCCESS;
+		}
+		if(EEPROM_readBlock(EEPROM_ringAddress(ring, ring->current), slot,
+				EEPROM_RING_HEADER_SIZE + ring->dataSize) == ERROR)
+		{
+			ring->current = EEPROM_RING_EMPTY;
+			return ERROR;
+		}
+		if(EEPROM_ringCheck(ring, slot))
+		{
+			return SUCCESS;
+		}
+		rejected |= (uint32)1 << ring->current;
+	}
+}
+
+uint8 EEPROM_ringWrite(EEPROM_RingType *ring, const uint8 *data)
+{
+	uint8 slot[EEPROM_RING_HEADER_SIZE + EEPROM_RING_MAX_DATA_SIZE];
+	uint16 sequence;
+	uint16 address;
+	uint8 next, i;
+
+	if(ring->dataSize > EEPROM_RING_MAX_DATA_SIZE)
+	{
+		return ERROR;
+	}
+
+	if(ring->current == EEPROM_RING_EMPTY)
+	{
+		next = 0;
+		sequence = 0;
+	}
+	else
+	{
+		next = (ring->current + 1) % ring->slotCount;
+		sequence = ring->sequence + 1;
+		if(sequence == EEPROM_RING_ERASED)
+		{
+			sequence = 0;
+		}
+	}
+
+	slot[0] = (uint8)(sequence);
+	slot[1] = (uint8)(sequence >> 8);
+	slot[EEPROM_RING_COMMIT_OFFSET] = 0xFF;	/* Clears the marker of the record overwritten in this slot */
+	for(i = 0; i < ring->dataSize; i++)
+	{
+		slot[EEPROM_RING_HEADER_SIZE + i] = data[i];
+	}
+	slot[EEPROM_RING_CRC_OFFSET] = EEPROM_ringCrc(ring, slot);
+
+	/* Only the bytes that differ from the record overwritten are programmed, the header
+	 * always differs so the old marker is cleared by the first page written.
+	 * The marker write waits for the write cycle of the data by acknowledge polling,
+	 * a power loss before it leaves the previous record the newest one */
+	address = EEPROM_ringAddress(ring, next);
+	if((EEPROM_updateBlock(address, slot, EEPROM_RING_HEADER_SIZE + ring->dataSize) == ERROR) ||
+			(EEPROM_writeByte(address + EEPROM_RING_COMMIT_OFFSET, EEPROM_RING_COMMITTED) == ERROR))
+	{
+		return ERROR;
+	}
+	ring->current = next;
+	ring->sequence = sequence;
+	return SUCCESS;
+}
+
+uint8 EEPROM_ringRead(const EEPROM_RingType *ring, uint8 *data)
+{
+	uint8 slot[EEPROM_RING_HEADER_SIZE + EEPROM_RING_MAX_DATA_SIZE];
+	uint8 i;
+
+	if((ring->current == EEPROM_RING_EMPTY) || (ring->dataSize > EEPROM_RING_MAX_DATA_SIZE))
+	{
+		return ERROR;
+	}
+	/* Header and data in one sequential read, checked together */
+	if(EEPROM_readBlock(EEPROM_ringAddress(ring, ring->current), slot, EEPROM_RING_HEADER_SIZE + ring->dataSize) == ERROR)
+	{
+		return ERROR;
+	}
+	if(!EEPROM_ringCheck(ring, slot))
+	{
+		return ERROR;
+	}
+	for(i = 0; i < ring->dataSize; i++)
+	{
+		data[i] = slot[EEPROM_RING_HEADER_SIZE + i];
+	}
+	return SUCCESS;
 }
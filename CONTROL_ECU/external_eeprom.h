@@ -22,11 +22,124 @@
 #define ERROR 0
 #define SUCCESS 1
 
+/* 24Cxx page: one write transaction may not cross a page boundary */
+#define EEPROM_PAGE_SIZE 16
+
+/* Worst case time of the internal write cycle that follows a write transaction,
+ * the device does not acknowledge its address until the cycle is over */
+#define EEPROM_WRITE_CYCLE_MS 10
+
+/* Number of times a failed transaction is tried again before ERROR is returned */
+#define EEPROM_MAX_RETRIES 3
+
+/* Every slot of a ring starts with a header: the 16 bits sequence number of the record,
+ * a CRC-8 of the sequence number and the data, then the commit marker */
+#define EEPROM_RING_HEADER_SIZE 4
+#define EEPROM_RING_CRC_OFFSET 2
+#define EEPROM_RING_COMMIT_OFFSET 3
+
+/* The commit marker is written last, once the rest of the slot is programmed,
+ * a slot without it was cut by a power loss and is ignored */
+#define EEPROM_RING_COMMITTED 0x5A
+
+/* Sequence number of a slot never written (erased cells read 0xFF) */
+#define EEPROM_RING_ERASED 0xFFFF
+
+/* Largest record a ring slot holds, and largest number of slots in a ring */
+#define EEPROM_RING_MAX_DATA_SIZE 32
+#define EEPROM_RING_MAX_SLOTS 32
+
+/* Value of EEPROM_RingType.current while the ring holds no record */
+#define EEPROM_RING_EMPTY 0xFF
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/*
+ * A record of dataSize bytes kept in a ring of slotCount slots from baseAddress on,
+ * each slot is the header and the data rounded up to whole pages.
+ * Every write goes to the slot after the newest one with the next sequence number,
+ * so each slot is written once every slotCount updates and the newest committed record
+ * is never overwritten: with 2 slots this is an A/B pair.
+ * baseAddress, dataSize and slotCount are set by the caller, current and sequence by EEPROM_ringInit().
+ */
+typedef struct
+{
+	uint16 baseAddress;     /* page aligned */
+	uint8 dataSize;
+	uint8 slotCount;
+	uint8 current;          /* slot of the newest valid record, EEPROM_RING_EMPTY if none */
+	uint16 sequence;        /* sequence number of the newest valid record */
+}EEPROM_RingType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+
+/*
+ * Description :
+ * Write length bytes from u16addr on, one page write per EEPROM page touched.
+ * Returns once the last page is sent, its write cycle is waited for by the next access.
+ * Returns ERROR if a page could not be written.
+ */
+uint8 EEPROM_writeBlock(uint16 u16addr, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Write length bytes from u16addr on, programming only what changed: each page touched
+ * is read in one burst first, a page that already holds the data is skipped and otherwise
+ * only the bytes from the first to the last different one are written.
+ * Returns ERROR if a page could not be read or written.
+ */
+uint8 EEPROM_updateBlock(uint16 u16addr, const uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Read length bytes from u16addr on with sequential reads: the memory address is sent
+ * once and every byte but the last is acknowledged. Returns ERROR if the read failed.
+ */
+uint8 EEPROM_readBlock(uint16 u16addr, uint8 *data, uint16 length);
+
+/*
+ * Description :
+ * Return TRUE while the device is busy with the write cycle of the last write.
+ * Does not wait: it only checks once whether the device acknowledges its address.
+ */
+bool EEPROM_isWriteBusy(void);
+
+/*
+ * Description :
+ * Wait until the write cycle of the last write is over, polling the device acknowledge.
+ * Returns ERROR if the device still does not answer after EEPROM_WRITE_CYCLE_MS.
+ */
+uint8 EEPROM_waitWriteDone(void);
+
+/*
+ * Description :
+ * Find the newest valid record of the ring at boot. Only the headers are read to pick
+ * the newest committed slot (highest sequence number in serial order), then its CRC
+ * is checked; a slot that fails is skipped for the next newest one.
+ * Returns ERROR if a slot could not be read.
+ */
+uint8 EEPROM_ringInit(EEPROM_RingType *ring);
+
+/*
+ * Description :
+ * Write dataSize bytes as the new record of the ring, in the slot after the newest one:
+ * header and data first, then the commit marker once they are programmed.
+ * Returns ERROR if the record could not be written, the previous record stays the newest.
+ */
+uint8 EEPROM_ringWrite(EEPROM_RingType *ring, const uint8 *data);
+
+/*
+ * Description :
+ * Read the dataSize bytes of the newest record of the ring.
+ * Returns ERROR if the ring is empty, the read failed or the record fails its CRC.
+ */
+uint8 EEPROM_ringRead(const EEPROM_RingType *ring, uint8 *data);
  
 #endif /* EXTERNAL_EEPROM_H_ */
@@ -0,0 +1,349 @@
+/******************************************************************************
+ *
+ * Module: KV_STORE
+ *
+ * File Name: kv_store.c
+ *
+ * Description: Source file for the key-value record store kept in the external EEPROM.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "kv_store.h"
+#include "external_eeprom.h"
+#include "frame.h"
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+/* Newest record of a key, address 0 if the key has no value (no record starts at 0) */
+typedef struct
+{
+	uint16 address;         /* address of the data of the record */
+	uint8 length;
+}KV_IndexEntryType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static KV_IndexEntryType g_index[KV_MAX_KEYS];
+
+/* Active bank (0 or 1), its generation and the address where the next record goes */
+static uint8 g_bank;
+static uint8 g_generation;
+static uint16 g_end;
+
+/* TRUE once KV_init() found or formatted a bank */
+static bool g_ready = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * First address of a bank.
+ */
+static uint16 KV_bankAddress(uint8 bank)
+{
+	return KV_BASE_ADDRESS + (uint16)bank * KV_BANK_SIZE;
+}
+
+/*
+ * Description :
+ * CRC-8 of a record: key, length and generation of the header, then the data.
+ */
+static uint8 KV_recordCrc(const uint8 *header, const uint8 *data)
+{
+	uint8 crc = 0;
+	uint8 i;
+
+	crc = FRAME_crc8(crc, header[0]);
+	crc = FRAME_crc8(crc, header[1]);
+	crc = FRAME_crc8(crc, header[2]);
+	for(i = 0; i < header[1]; i++)
+	{
+		crc = FRAME_crc8(crc, data[i]);
+	}
+	return crc;
+}
+
+/*
+ * Description :
+ * Write a record at address: header and data first, then the commit marker once they
+ * are programmed (the EEPROM driver waits for the write cycle by acknowledge polling).
+ */
+static uint8 KV_writeRecord(uint16 address, uint8 generation, uint8 key, const uint8 *data, uint8 length)
+{
+	uint8 record[KV_RECORD_HEADER_SIZE + KV_MAX_VALUE_SIZE];
+	uint8 i;
+
+	record[0] = key;
+	record[1] = length;
+	record[2] = generation;
+	record[4] = 0xFF;
+	for(i = 0; i < length; i++)
+	{
+		record[KV_RECORD_HEADER_SIZE + i] = data[i];
+	}
+	record[3] = KV_recordCrc(record, &record[KV_RECORD_HEADER_SIZE]);
+
+	if(EEPROM_writeBlock(address, record, KV_RECORD_HEADER_SIZE + length) == ERROR)
+	{
+		return ERROR;
+	}
+	return EEPROM_writeByte(address + 4, KV_COMMITTED);
+}
+
+/*
+ * Description :
+ * Write the header of a bank, the commit marker last: until it is written the other bank stays active.
+ */
+static uint8 KV_writeBankHeader(uint8 bank, uint8 generation)
+{
+	uint8 header[KV_BANK_HEADER_SIZE];
+
+	header[0] = generation;
+	header[1] = FRAME_crc8(0, generation);
+	header[2] = 0xFF;
+
+	if(EEPROM_writeBlock(KV_bankAddress(bank), header, KV_BANK_HEADER_SIZE) == ERROR)
+	{
+		return ERROR;
+	}
+	return EEPROM_writeByte(KV_bankAddress(bank) + 2, KV_COMMITTED);
+}
+
+/*
+ * Description :
+ * Read the header of a bank. Returns TRUE if it is committed, with its generation.
+ */
+static bool KV_readBankHeader(uint8 bank, uint8 *generation, uint8 *status)
+{
+	uint8 header[KV_BANK_HEADER_SIZE];
+
+	*status = EEPROM_readBlock(KV_bankAddress(bank), header, KV_BANK_HEADER_SIZE);
+	if((*status == ERROR) || (header[2] != KV_COMMITTED) || (header[1] != FRAME_crc8(0, header[0])))
+	{
+		return FALSE;
+	}
+	*generation = header[0];
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Walk the log of the active bank and point the index to the newest record of every key.
+ * The log ends at the first record that is not a committed record of this generation.
+ */
+static uint8 KV_buildIndex(void)
+{
+	uint8 record[KV_RECORD_HEADER_SIZE + KV_MAX_VALUE_SIZE];
+	uint16 address = KV_bankAddress(g_bank) + KV_BANK_HEADER_SIZE;
+	uint16 bankEnd = KV_bankAddress(g_bank) + KV_BANK_SIZE;
+	uint8 key;
+
+	for(key = 0; key < KV_MAX_KEYS; key++)
+	{
+		g_index[key].address = 0;
+	}
+
+	while(address + KV_RECORD_HEADER_SIZE <= bankEnd)
+	{
+		if(EEPROM_readBlock(address, record, KV_RECORD_HEADER_SIZE) == ERROR)
+		{
+			return ERROR;
+		}
+		if((record[0] >= KV_MAX_KEYS) || (record[1] > KV_MAX_VALUE_SIZE) || (record[2] != g_generation) ||
+				(record[4] != KV_COMMITTED) || (address + KV_RECORD_HEADER_SIZE + record[1] > bankEnd))
+		{
+			break;
+		}
+		if(EEPROM_readBlock(address + KV_RECORD_HEADER_SIZE, &record[KV_RECORD_HEADER_SIZE], record[1]) == ERROR)
+		{
+			return ERROR;
+		}
+		if(record[3] != KV_recordCrc(record, &record[KV_RECORD_HEADER_SIZE]))
+		{
+			break;
+		}
+
+		g_index[record[0]].address = address + KV_RECORD_HEADER_SIZE;
+		g_index[record[0]].length = record[1];
+		address += KV_RECORD_HEADER_SIZE + record[1];
+	}
+
+	/* The next record overwrites whatever ended the log */
+	g_end = address;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Copy the newest record of every key to the other bank, commit its header with the
+ * next generation and make it the active bank. A power loss before the header is
+ * committed leaves the current bank active.
+ */
+static uint8 KV_compact(void)
+{
+	uint8 data[KV_MAX_VALUE_SIZE];
+	uint16 newAddress[KV_MAX_KEYS];
+	uint8 bank = g_bank ^ 1;
+	uint8 generation = g_generation + 1;
+	uint16 address = KV_bankAddress(bank) + KV_BANK_HEADER_SIZE;
+	uint16 bankEnd = KV_bankAddress(bank) + KV_BANK_SIZE;
+	uint8 key;
+
+	for(key = 0; key < KV_MAX_KEYS; key++)
+	{
+		newAddress[key] = 0;
+		if(g_index[key].address == 0)
+		{
+			continue;
+		}
+		/* Never spill into the next area, the header stays uncommitted and the current bank active */
+		if(address + KV_RECORD_HEADER_SIZE + g_index[key].length > bankEnd)
+		{
+			return ERROR;
+		}
+		if((EEPROM_readBlock(g_index[key].address, data, g_index[key].length) == ERROR) ||
+				(KV_writeRecord(address, generation, key, data, g_index[key].length) == ERROR))
+		{
+			return ERROR;
+		}
+		newAddress[key] = address + KV_RECORD_HEADER_SIZE;
+		address += KV_RECORD_HEADER_SIZE + g_index[key].length;
+	}
+
+	if(KV_writeBankHeader(bank, generation) == ERROR)
+	{
+		return ERROR;
+	}
+
+	for(key = 0; key < KV_MAX_KEYS; key++)
+	{
+		g_index[key].address = newAddress[key];
+	}
+	g_bank = bank;
+	g_generation = generation;
+	g_end = address;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Pick the active bank and rebuild the RAM index from its log, formatting the store
+ * if no bank is valid (first boot). Needs the TWI driver.
+ * Returns ERROR if the EEPROM could not be accessed, the store is then unusable.
+ */
+uint8 KV_init(void)
+{
+	uint8 generation[2];
+	bool valid[2];
+	uint8 status;
+	uint8 bank;
+
+	g_ready = FALSE;
+
+	for(bank = 0; bank < 2; bank++)
+	{
+		valid[bank] = KV_readBankHeader(bank, &generation[bank], &status);
+		if(status == ERROR)
+		{
+			return ERROR;
+		}
+	}
+
+	if(valid[0] && valid[1])
+	{
+		/* Both committed: a compaction ended, the newer generation in serial order is active */
+		g_bank = ((sint8)(generation[1] - generation[0]) > 0) ? 1 : 0;
+	}
+	else if(valid[0] || valid[1])
+	{
+		g_bank = valid[1] ? 1 : 0;
+	}
+	else
+	{
+		g_bank = 0;
+		generation[0] = 0;
+		if(KV_writeBankHeader(0, 0) == ERROR)
+		{
+			return ERROR;
+		}
+	}
+	g_generation = generation[g_bank];
+
+	if(KV_buildIndex() == ERROR)
+	{
+		return ERROR;
+	}
+	g_ready = TRUE;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Store length bytes as the value of key, nothing is written if the value is unchanged.
+ * Returns ERROR if the key or length is out of range, the store is full even after
+ * compaction or the EEPROM could not be written (the previous value is kept).
+ */
+uint8 KV_write(uint8 key, const uint8 *data, uint8 length)
+{
+	uint8 current[KV_MAX_VALUE_SIZE];
+	uint8 i;
+
+	if(!g_ready || (key >= KV_MAX_KEYS) || (length > KV_MAX_VALUE_SIZE))
+	{
+		return ERROR;
+	}
+
+	if((g_index[key].address != 0) && (g_index[key].length == length) &&
+			(EEPROM_readBlock(g_index[key].address, current, length) == SUCCESS))
+	{
+		for(i = 0; (i < length) && (current[i] == data[i]); i++);
+		if(i == length)
+		{
+			return SUCCESS;
+		}
+	}
+
+	if(g_end + KV_RECORD_HEADER_SIZE + length > KV_bankAddress(g_bank) + KV_BANK_SIZE)
+	{
+		if(KV_compact() == ERROR)
+		{
+			return ERROR;
+		}
+		if(g_end + KV_RECORD_HEADER_SIZE + length > KV_bankAddress(g_bank) + KV_BANK_SIZE)
+		{
+			return ERROR;
+		}
+	}
+
+	/* g_end only moves on once the record is committed, a failed record is overwritten by the next one */
+	if(KV_writeRecord(g_end, g_generation, key, data, length) == ERROR)
+	{
+		return ERROR;
+	}
+	g_index[key].address = g_end + KV_RECORD_HEADER_SIZE;
+	g_index[key].length = length;
+	g_end += KV_RECORD_HEADER_SIZE + length;
+	return SUCCESS;
+}
+
+/*
+ * Description :
+ * Read the value of key. The length is the type of the value: returns ERROR if key
+ * has no value of length bytes or the EEPROM could not be read.
+ */
+uint8 KV_read(uint8 key, uint8 *data, uint8 length)
+{
+	if(!g_ready || (key >= KV_MAX_KEYS) || (g_index[key].address == 0) || (g_index[key].length != length))
+	{
+		return ERROR;
+	}
+	return EEPROM_readBlock(g_index[key].address, data, length);
+}
@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * Module: KV_STORE
+ *
+ * File Name: kv_store.h
+ *
+ * Description: Header file for the key-value record store kept in the external EEPROM.
+ *
+ * The store is a log in one of two banks: every write appends a record
+ *  +-----+--------+------------+-----+--------+-------------+
+ *  | KEY | LENGTH | GENERATION | CRC | COMMIT | DATA[LENGTH]|
+ *  +-----+--------+------------+-----+--------+-------------+
+ * after the last one, the newest record of a key is its value. A RAM index holds
+ * the address of the newest record of every key, rebuilt at boot by one pass over
+ * the log, so a lookup never searches the EEPROM. When the bank is full the newest
+ * records are copied to the other bank (compaction) which then becomes the active one.
+ * GENERATION is the generation of the bank, records left from an older use of the bank
+ * end the log. CRC is a CRC-8 of KEY, LENGTH, GENERATION and DATA and COMMIT is written
+ * last, so a record cut by a power loss also ends the log and the older value is kept.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef KV_STORE_H_
+#define KV_STORE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* EEPROM area of the store: two banks of KV_BANK_SIZE bytes from KV_BASE_ADDRESS on */
+#define KV_BASE_ADDRESS 0x0000
+#define KV_BANK_SIZE 0x0100
+
+/* Keys are 0 .. KV_MAX_KEYS - 1, a value holds at most KV_MAX_VALUE_SIZE bytes */
+#define KV_MAX_KEYS 8
+#define KV_MAX_VALUE_SIZE 16
+
+/* Bank header: generation, CRC-8 of the generation and commit marker */
+#define KV_BANK_HEADER_SIZE 3
+
+/* Record header: key, length, generation, CRC-8 and commit marker */
+#define KV_RECORD_HEADER_SIZE 5
+
+/* Compaction copies one record per key to the other bank: the largest values of all keys must fit */
+#if (KV_MAX_KEYS * (KV_RECORD_HEADER_SIZE + KV_MAX_VALUE_SIZE)) > (KV_BANK_SIZE - KV_BANK_HEADER_SIZE)
+#error "KV_MAX_KEYS values of KV_MAX_VALUE_SIZE bytes do not fit in a bank"
+#endif
+
+/* Written last in a bank header or a record */
+#define KV_COMMITTED 0x5A
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Pick the active bank and rebuild the RAM index from its log, formatting the store
+ * if no bank is valid (first boot). Needs the TWI driver.
+ * Returns ERROR if the EEPROM could not be accessed, the store is then unusable.
+ */
+uint8 KV_init(void);
+
+/*
+ * Description :
+ * Store length bytes as the value of key, nothing is written if the value is unchanged.
+ * Returns ERROR if the key or length is out of range, the store is full even after
+ * compaction or the EEPROM could not be written (the previous value is kept).
+ */
+uint8 KV_write(uint8 key, const uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Read the value of key. The length is the type of the value: returns ERROR if key
+ * has no value of length bytes or the EEPROM could not be read.
+ */
+uint8 KV_read(uint8 key, uint8 *data, uint8 length);
+
+#endif /* KV_STORE_H_ */
@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ * Module: LINK
+ *
+ * File Name: link.h
+ *
+ * Description: Header file for the management of the UART link between the
+ * HMI ECU and the Control ECU.
+ *
+ * Both ECUs boot at LINK_BASE_BAUD. The HMI ECU (master) then proposes the
+ * rates of LINK_BAUD_RATES from the fastest one, each proposal is accepted by
+ * the Control ECU (slave), both switch, and a probe frame is echoed back at the
+ * new rate. The first rate that echoes the probe without errors is committed:
+ * the master sends a commit frame at the new rate and the slave echoes it, the
+ * master repeats the commit up to LINK_COMMIT_RETRIES times until the echo arrives.
+ * Otherwise both sides return to LINK_BASE_BAUD and the next rate is tried.
+ *
+ * While running, LINK_monitor() falls back to LINK_BASE_BAUD when the number of
+ * errors reaches LINK_ERROR_THRESHOLD: framing/parity errors, bytes lost to a receive
+ * overrun (the likely failure at the fastest rates, while another interrupt runs) and
+ * frames rejected for a wrong CRC or length.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Baud rate both ECUs use after reset and fall back to */
+#define LINK_BASE_BAUD 9600UL
+
+/* Candidate baud rates from the fastest to the slowest, all exact or within 0.2% at 8MHz with U2X */
+#define LINK_BAUD_RATES {500000UL, 250000UL, 125000UL, 38400UL}
+#define LINK_NUMBER_OF_BAUD_RATES 4
+
+/* Rates whose UBRR rounding error is above this limit (in 1/1000) are never proposed */
+#define LINK_MAX_BAUD_ERROR_PERMILLE 10
+
+/* Number of link errors that make the link fall back to LINK_BASE_BAUD */
+#define LINK_ERROR_THRESHOLD 8
+
+/* Time to wait for an answer of the peer during the negotiation */
+#define LINK_REPLY_TIMEOUT_MS 50
+
+/* Time the master gives the slave to switch after its accept frame was received */
+#define LINK_SWITCH_DELAY_MS 1
+
+/* Number of commit frames the master sends at the new rate before it gives up on the echo */
+#define LINK_COMMIT_RETRIES 3
+
+/* Time the master waits after a failed probe so the slave times out and returns to the base rate */
+#define LINK_SETTLE_TIME_MS (3 * LINK_REPLY_TIMEOUT_MS)
+
+/* Time the slave waits for a proposal: after a failed rate the master may still repeat its commit
+ * then waits LINK_SETTLE_TIME_MS before the next proposal, the slave must still be listening */
+#define LINK_PROPOSE_TIMEOUT_MS (LINK_COMMIT_RETRIES * LINK_REPLY_TIMEOUT_MS + LINK_SETTLE_TIME_MS)
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the UART at LINK_BASE_BAUD, 8 data bits, no parity and 1 stop bit.
+ * The negotiation timeouts need the system tick (Tick_init).
+ */
+void LINK_init(void);
+
+/*
+ * Description :
+ * Run the negotiation as master (HMI ECU) and switch to the fastest rate the peer echoes cleanly.
+ * The peer must be told to call LINK_negotiateSlave() before.
+ * Returns TRUE if a faster rate was committed, FALSE if the link stays at LINK_BASE_BAUD.
+ */
+bool LINK_negotiateMaster(void);
+
+/*
+ * Description :
+ * Answer a negotiation started by LINK_negotiateMaster() (Control ECU).
+ * Returns once a rate was committed or no proposal came for LINK_PROPOSE_TIMEOUT_MS.
+ */
+void LINK_negotiateSlave(void);
+
+/*
+ * Description :
+ * Fall back to LINK_BASE_BAUD if too many bytes were corrupted or lost or too many frames rejected.
+ * The failed rate and every faster one are not proposed again.
+ * Returns TRUE if the link fell back during this call.
+ */
+bool LINK_monitor(void);
+
+/*
+ * Description :
+ * Return the baud rate currently used on the link.
+ */
+uint32 LINK_getBaudRate(void);
+
+#endif /* LINK_H_ */
@@ -0,0 +1,208 @@
+/******************************************************************************
+ *
+ * Module: PROTOCOL
+ *
+ * File Name: protocol.c
+ *
+ * Description: Source file for the request/response protocol between the HMI ECU
+ * and the Control ECU.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "protocol.h"
+#include "frame.h"
+#include "uart.h"
+#include "timer.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Master: sequence number of the next request */
+static uint8 g_seq = 0;
+
+/* Slave: receiver of the requests, master: receiver of the notifications.
+ * The payload is received in g_requestPayload */
+static FRAME_RxType g_requestFrame;
+static uint8 g_requestPayload[FRAME_MAX_PAYLOAD];
+
+/* Slave: last response, sent again if its request is repeated */
+static bool g_lastResponseValid = FALSE;
+static uint8 g_lastType;
+static uint8 g_lastSeq;
+static uint8 g_lastLength;
+static uint8 g_lastResponse[FRAME_MAX_PAYLOAD];
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the protocol state, call once after the UART is initialized.
+ */
+void PROTOCOL_init(void)
+{
+	g_seq = 0;
+	g_lastResponseValid = FALSE;
+	FRAME_initReceiver(&g_requestFrame, g_requestPayload, FRAME_MAX_PAYLOAD);
+}
+
+/*
+ * Description :
+ * Master: send a request and wait for its response, repeating the request if needed.
+ * The response payload is received in response (capacity bytes at most) and its length
+ * stored in responseLength unless it is NULL_PTR.
+ * Returns FALSE if the slave did not answer.
+ */
+bool PROTOCOL_request(uint8 type, const uint8 *payload, uint8 length,
+		uint8 *response, uint8 capacity, uint8 *responseLength)
+{
+	uint8 attempt;
+	uint32 start;
+	FRAME_RxType Reply;
+	FRAME_Status status;
+
+	uint8 seq = g_seq;
+
+	/* Sequence number 0 is kept for the first request after reset */
+	g_seq++;
+	if(g_seq == 0)
+	{
+		g_seq = 1;
+	}
+	FRAME_initReceiver(&Reply, response, capacity);
+
+	for(attempt = 0; attempt <= PROTOCOL_MAX_RETRIES; attempt++)
+	{
+		FRAME_send(type, seq, payload, length);
+		start = Tick_getMs();
+
+		while(!Tick_isElapsed(start, PROTOCOL_RESPONSE_TIMEOUT_MS))
+		{
+			status = FRAME_poll(&Reply);
+			if(status != FRAME_OK)
+			{
+				continue;
+			}
+			if((Reply.type == (type | PROTOCOL_RESPONSE_FLAG)) && (Reply.seq == seq))
+			{
+				if(responseLength != NULL_PTR)
+				{
+					*responseLength = Reply.length;
+				}
+				return TRUE;
+			}
+			if(Reply.type == FRAME_NACK)
+			{
+				/* The request was corrupted, no need to wait for the timeout */
+				break;
+			}
+			/* Anything else is a late response of an older request */
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Slave: check for a new request without blocking.
+ * Returns TRUE and fills request when one was received. Repeated requests are answered
+ * with the remembered response and corrupted ones with a FRAME_NACK.
+ */
+bool PROTOCOL_pollRequest(PROTOCOL_RequestType *request)
+{
+	switch(FRAME_poll(&g_requestFrame))
+	{
+	case FRAME_OK:
+		if(g_requestFrame.type & PROTOCOL_RESPONSE_FLAG)
+		{
+			return FALSE;
+		}
+		if(g_lastResponseValid && (g_requestFrame.seq != 0) &&
+				(g_requestFrame.type == g_lastType) && (g_requestFrame.seq == g_lastSeq))
+		{
+			/* The response was lost, answer again without executing the request twice */
+			FRAME_send(g_lastType | PROTOCOL_RESPONSE_FLAG, g_lastSeq, g_lastResponse, g_lastLength);
+			return FALSE;
+		}
+		request->type = g_requestFrame.type;
+		request->seq = g_requestFrame.seq;
+		request->length = g_requestFrame.length;
+		request->payload = g_requestPayload;
+		return TRUE;
+
+	case FRAME_CRC_ERROR:
+	case FRAME_LENGTH_ERROR:
+		FRAME_send(FRAME_NACK, 0, NULL_PTR, 0);
+		return FALSE;
+
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * Description :
+ * Slave: send the response of a request and remember it in case the request is repeated.
+ */
+void PROTOCOL_respond(const PROTOCOL_RequestType *request, const uint8 *payload, uint8 length)
+{
+	uint8 i;
+
+	g_lastType = request->type;
+	g_lastSeq = request->seq;
+	g_lastLength = length;
+	for(i = 0; i < length; i++)
+	{
+		g_lastResponse[i] = payload[i];
+	}
+	g_lastResponseValid = TRUE;
+
+	FRAME_send(request->type | PROTOCOL_RESPONSE_FLAG, request->seq, payload, length);
+}
+
+/*
+ * Description :
+ * Slave: drop everything received while the application could not answer requests.
+ */
+void PROTOCOL_flush(void)
+{
+	UART_clearReceiveBuffer();
+	FRAME_initReceiver(&g_requestFrame, g_requestPayload, FRAME_MAX_PAYLOAD);
+}
+
+/*
+ * Description :
+ * Slave: send a notification to the master.
+ */
+void PROTOCOL_notify(uint8 type, const uint8 *payload, uint8 length)
+{
+	/* Sequence number 0, a notification is neither acknowledged nor repeated */
+	FRAME_send(type, 0, payload, length);
+}
+
+/*
+ * Description :
+ * Master: check for a notification from the slave without blocking.
+ * Returns TRUE and fills notification when one was received.
+ */
+bool PROTOCOL_pollNotification(PROTOCOL_RequestType *notification)
+{
+	if(FRAME_poll(&g_requestFrame) != FRAME_OK)
+	{
+		return FALSE;
+	}
+	if((g_requestFrame.type & PROTOCOL_RESPONSE_FLAG) || (g_requestFrame.type == FRAME_NACK))
+	{
+		/* A late response of an older request */
+		return FALSE;
+	}
+	notification->type = g_requestFrame.type;
+	notification->seq = g_requestFrame.seq;
+	notification->length = g_requestFrame.length;
+	notification->payload = g_requestPayload;
+	return TRUE;
+}
@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ * Module: SCHEDULER
+ *
+ * File Name: scheduler.c
+ *
+ * Description: Source file for the cooperative run-to-completion task scheduler.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "scheduler.h"
+#include "timer.h"
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef struct
+{
+	void (*task)(void);
+	uint32 period;          /* ms between two runs, 0 for an event task */
+	uint32 lastRun;         /* tick of the last periodic run */
+	volatile bool ready;    /* set by SCHEDULER_signal(), cleared when the task runs */
+}SCHEDULER_TaskType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static SCHEDULER_TaskType g_tasks[SCHEDULER_MAX_TASKS];
+static uint8 g_taskCount = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add a task, in decreasing order of priority. Period_ms = 0 makes an event task
+ * that only runs when signalled. Needs the system tick (Tick_init).
+ * Returns the task id or SCHEDULER_INVALID_TASK if the table is full.
+ */
+uint8 SCHEDULER_addTask(void (*aTask_ptr)(void), uint32 Period_ms)
+{
+	if((g_taskCount >= SCHEDULER_MAX_TASKS) || (aTask_ptr == NULL_PTR))
+	{
+		return SCHEDULER_INVALID_TASK;
+	}
+
+	g_tasks[g_taskCount].task = aTask_ptr;
+	g_tasks[g_taskCount].period = Period_ms;
+	g_tasks[g_taskCount].lastRun = Tick_getMs();
+	g_tasks[g_taskCount].ready = FALSE;
+
+	return g_taskCount++;
+}
+
+/*
+ * Description :
+ * Mark a task ready to run once. Safe to call from an interrupt or a software timer call back.
+ */
+void SCHEDULER_signal(uint8 Id)
+{
+	if(Id < g_taskCount)
+	{
+		/* A single byte write, no need to disable the interrupts */
+		g_tasks[Id].ready = TRUE;
+	}
+}
+
+/*
+ * Description :
+ * Run the ready task with the highest priority, if any.
+ * Returns TRUE if a task ran.
+ */
+bool SCHEDULER_dispatch(void)
+{
+	uint8 i;
+	uint32 now = Tick_getMs();
+
+	for(i = 0; i < g_taskCount; i++)
+	{
+		if((g_tasks[i].period != 0) && Tick_isElapsed(g_tasks[i].lastRun, g_tasks[i].period))
+		{
+			/* Keep the period exact unless the task is running late by a whole period */
+			g_tasks[i].lastRun += g_tasks[i].period;
+			if(Tick_isElapsed(g_tasks[i].lastRun, g_tasks[i].period))
+			{
+				g_tasks[i].lastRun = now;
+			}
+			g_tasks[i].ready = TRUE;
+		}
+
+		if(g_tasks[i].ready)
+		{
+			g_tasks[i].ready = FALSE;
+			(*g_tasks[i].task)();
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Run the tasks forever.
+ */
+void SCHEDULER_run(void)
+{
+	while(1)
+	{
+		SCHEDULER_dispatch();
+	}
+}
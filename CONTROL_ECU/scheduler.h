@@ -0,0 +1,65 @@
+/******************************************************************************
+ *
+ * Module: SCHEDULER
+ *
+ * File Name: scheduler.h
+ *
+ * Description: Header file for the cooperative run-to-completion task scheduler.
+ *
+ * A task is a function that does a short piece of work and returns. It runs
+ * every Period_ms milliseconds (periodic task) and/or when SCHEDULER_signal()
+ * marks it ready (event task, Period_ms = 0). Tasks never preempt each other:
+ * the scheduler runs the ready task added first, then looks again from the
+ * first task, so the latency of a task is bounded by the longest task.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Maximum number of tasks */
+#define SCHEDULER_MAX_TASKS 8
+
+/* Returned by SCHEDULER_addTask() when the task table is full */
+#define SCHEDULER_INVALID_TASK 0xFF
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add a task, in decreasing order of priority. Period_ms = 0 makes an event task
+ * that only runs when signalled. Needs the system tick (Tick_init).
+ * Returns the task id or SCHEDULER_INVALID_TASK if the table is full.
+ */
+uint8 SCHEDULER_addTask(void (*aTask_ptr)(void), uint32 Period_ms);
+
+/*
+ * Description :
+ * Mark a task ready to run once. Safe to call from an interrupt or a software timer call back.
+ */
+void SCHEDULER_signal(uint8 Id);
+
+/*
+ * Description :
+ * Run the ready task with the highest priority, if any.
+ * Returns TRUE if a task ran.
+ */
+bool SCHEDULER_dispatch(void);
+
+/*
+ * Description :
+ * Run the tasks forever.
+ */
+void SCHEDULER_run(void);
+
+#endif /* SCHEDULER_H_ */
@@ -12,6 +12,24 @@
 /* Global variables to hold the address of the call back function in the application */
 static volatile void (*g_callBackTimerPtr)(void) = NULL_PTR;
 
+/* Milliseconds elapsed since Tick_init() */
+static volatile uint32 g_tickMs = 0;
+
+/* Time since the last counted millisecond, in units of 1/1000 Timer1 count (always below TICK_CLOCK_HZ) */
+static volatile uint32 g_tickFraction = 0;
+
+/* Software timers served by the system tick */
+typedef struct
+{
+	void (*callBack)(void);
+	uint32 period;          /* reload value of a periodic timer in ms */
+	uint32 remaining;       /* ms left before the expiry, 0 when the timer is stopped */
+	SoftTimer_Mode mode;
+	bool allocated;
+}SoftTimer_Type;
+
+static volatile SoftTimer_Type g_softTimers[SOFT_TIMER_MAX_NUMBER];
+
 
 
 
@@ -59,8 +77,8 @@ void Timer1_init(const Timer1_ConfigType *Config_Ptr) {
 				TCCR1A&=~(1<<FOC1B);
 				/*Set Compare Value*/
 				OCR1A = Config_Ptr ->compare_value;
-				TCCR1B = (TCCR1B & 0xF8) | (Config_Ptr->Timer1prescaler);
-				TCCR1B = (1<<WGM12);
+				/*CTC mode (WGM12=1) keeping the prescaler*/
+				TCCR1B = (1<<WGM12) | (Config_Ptr->Timer1prescaler);
 				break;
 
 			}
@@ -89,3 +107,195 @@ void Timer1_setCallBack( void(*aTimer_ptr)(void))
 	/* Save the address of the Call back function in a global variable */
 	g_callBackTimerPtr = aTimer_ptr;
 }
+
+/*
+ * Description: Count the elapsed milliseconds and serve the software timers, called by the Timer1 compare interrupt.
+ */
+static void Tick_handler(void)
+{
+	uint8 i;
+
+	/* An interrupt lasts at most 1 ms, so it completes at most one millisecond */
+	g_tickFraction += TICK_FRACTION_PER_INTERRUPT;
+	if(g_tickFraction < TICK_CLOCK_HZ)
+	{
+		return;
+	}
+	g_tickFraction -= TICK_CLOCK_HZ;
+	g_tickMs++;
+
+	for(i = 0; i < SOFT_TIMER_MAX_NUMBER; i++)
+	{
+		if((g_softTimers[i].remaining != 0) && (--g_softTimers[i].remaining == 0))
+		{
+			/* Reload before the call back so it may stop or restart the timer */
+			if(g_softTimers[i].mode == SOFT_TIMER_PERIODIC)
+			{
+				g_softTimers[i].remaining = g_softTimers[i].period;
+			}
+			if(g_softTimers[i].callBack != NULL_PTR)
+			{
+				(*g_softTimers[i].callBack)();
+			}
+		}
+	}
+}
+
+/*
+ * Description: Start the 1 ms system tick on Timer1 used for timeouts and software timers.
+ * Timer1 keeps running from now on, so it must not be reconfigured by the application.
+ */
+void Tick_init(void)
+{
+	Timer1_ConfigType Tick_Config = {COMPARE, TICK_PRESCALER, 0, TICK_COMPARE_VALUE};
+
+	Timer1_DeInit();
+	g_tickMs = 0;
+	g_tickFraction = 0;
+	Timer1_setCallBack(Tick_handler);
+	Timer1_init(&Tick_Config);
+}
+
+/*
+ * Description: Return the number of milliseconds elapsed since Tick_init() (millis).
+ * Wraps around after about 49 days.
+ */
+uint32 Tick_getMs(void)
+{
+	uint32 ms;
+	uint8 sreg = SREG;
+
+	/* The counter is 4 bytes wide so the ISR must not update it while it is copied */
+	cli();
+	ms = g_tickMs;
+	SREG = sreg;
+
+	return ms;
+}
+
+/*
+ * Description: Return the number of microseconds elapsed since Tick_init() (micros),
+ * with the resolution of one Timer1 count. Wraps around after about 71 minutes,
+ * differences of two readings stay correct across the wrap around.
+ */
+uint32 Tick_getUs(void)
+{
+	uint32 ms, fraction;
+	uint16 counts;
+	uint8 sreg = SREG;
+
+	/* Copy the counters and the timer in one go so they describe the same instant */
+	cli();
+	ms = g_tickMs;
+	fraction = g_tickFraction;
+	counts = TCNT1;
+	if((TIFR & (1<<OCF1A)) && (counts < TICK_COMPARE_VALUE))
+	{
+		/* The timer wrapped after interrupts were disabled, the pending interrupt is not counted yet */
+		counts += TICK_COMPARE_VALUE + 1;
+	}
+	SREG = sreg;
+
+	/* Units of 1/1000 count since the last counted millisecond, TICK_CLOCK_HZ of them make 1000 us */
+	fraction += (uint32)counts * 1000UL;
+	return (ms * 1000UL) + ((fraction * 1000UL) / TICK_CLOCK_HZ);
+}
+
+/*
+ * Description: Return TRUE once Timeout_ms milliseconds passed since the Start tick.
+ * Correct across the wrap around of the tick counter.
+ */
+bool Tick_isElapsed(uint32 Start, uint32 Timeout_ms)
+{
+	return (Tick_getMs() - Start) >= Timeout_ms;
+}
+
+/*
+ * Description: Reserve a software timer calling aCallBack_ptr on every expiry.
+ * The call back runs from the tick interrupt so it must be short (set a flag, start an action).
+ * Return the timer id or SOFT_TIMER_INVALID if all the timers are in use.
+ */
+uint8 SoftTimer_create(void(*aCallBack_ptr)(void))
+{
+	uint8 i;
+
+	for(i = 0; i < SOFT_TIMER_MAX_NUMBER; i++)
+	{
+		if(!g_softTimers[i].allocated)
+		{
+			g_softTimers[i].allocated = TRUE;
+			g_softTimers[i].remaining = 0;
+			g_softTimers[i].callBack = aCallBack_ptr;
+			return i;
+		}
+	}
+	return SOFT_TIMER_INVALID;
+}
+
+/*
+ * Description: (Re)start a software timer to expire after Period_ms milliseconds,
+ * once (SOFT_TIMER_ONE_SHOT) or every Period_ms (SOFT_TIMER_PERIODIC).
+ */
+void SoftTimer_start(uint8 Id, uint32 Period_ms, SoftTimer_Mode Mode)
+{
+	uint8 sreg = SREG;
+
+	if(Id >= SOFT_TIMER_MAX_NUMBER)
+	{
+		return;
+	}
+	if(Period_ms == 0)
+	{
+		Period_ms = 1;	/* a zero count would mean stopped, expire on the next tick instead */
+	}
+
+	/* The tick interrupt decrements the 4 bytes counter, update the timer atomically */
+	cli();
+	g_softTimers[Id].period = Period_ms;
+	g_softTimers[Id].mode = Mode;
+	g_softTimers[Id].remaining = Period_ms;
+	SREG = sreg;
+}
+
+/*
+ * Description: Stop a software timer without calling its call back.
+ */
+void SoftTimer_stop(uint8 Id)
+{
+	uint8 sreg = SREG;
+
+	if(Id >= SOFT_TIMER_MAX_NUMBER)
+	{
+		return;
+	}
+	cli();
+	g_softTimers[Id].remaining = 0;
+	SREG = sreg;
+}
+
+/*
+ * Description: Return TRUE while the software timer is counting.
+ */
+bool SoftTimer_isRunning(uint8 Id)
+{
+	return SoftTimer_getRemainingMs(Id) != 0;
+}
+
+/*
+ * Description: Return the milliseconds left before the software timer expires, 0 if it is stopped.
+ */
+uint32 SoftTimer_getRemainingMs(uint8 Id)
+{
+	uint32 remaining;
+	uint8 sreg = SREG;
+
+	if(Id >= SOFT_TIMER_MAX_NUMBER)
+	{
+		return 0;
+	}
+	cli();
+	remaining = g_softTimers[Id].remaining;
+	SREG = sreg;
+
+	return remaining;
+}
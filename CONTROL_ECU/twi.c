@@ -2,7 +2,7 @@
  *
  * Module: TWI(I2C)
  *
- * File Name: twi.h
+ * File Name: twi.c
  *
  * Description: Source file for the TWI(I2C) AVR driver
  *
@@ -12,7 +12,254 @@
  
 #include "twi.h"
 #include "common_macros.h"
+#include "timer.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Queue of the transactions of the engine, the head is the running one */
+static TWI_TransactionType * volatile g_queueHead = NULL_PTR;
+static TWI_TransactionType * volatile g_queueTail = NULL_PTR;
+
+/* Number of bytes already written / read by the running transaction */
+static volatile uint8 g_index = 0;
+
+/* Software timer ending a transaction stuck on one step */
+static uint8 g_stepTimer = SOFT_TIMER_INVALID;
+
+static volatile TWI_ErrorCountersType g_errorCounters;
+
+/* Set by the step timer when the bus must be recovered, the queue waits for TWI_serviceRecovery() */
+static volatile bool g_recoveryPending = FALSE;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Increment an error counter without wrapping around.
+ */
+static void TWI_countError(volatile uint8 *counter)
+{
+	if(*counter != 0xFF)
+	{
+		(*counter)++;
+	}
+}
+
+/*
+ * Description :
+ * Wait for the end of a polled step. Returns FALSE if it took longer than TWI_STEP_TIMEOUT_MS.
+ */
+static bool TWI_waitForStep(void)
+{
+	uint32 start = Tick_getMs();
+
+	/* Wait for TWINT flag set in TWCR Register (the step is done) */
+	while(BIT_IS_CLEAR(TWCR,TWINT))
+	{
+		if(Tick_isElapsed(start, TWI_STEP_TIMEOUT_MS))
+		{
+			TWI_countError(&g_errorCounters.timeout);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Send a start (or stop then start) for the transaction at the head of the queue.
+ */
+static void TWI_startTransaction(uint8 stop)
+{
+	g_index = 0;
+	g_queueHead->status = TWI_BUSY;
+	SoftTimer_start(g_stepTimer, TWI_STEP_TIMEOUT_MS, SOFT_TIMER_ONE_SHOT);
+	TWCR = (1 << TWINT) | (1 << TWSTA) | stop | (1 << TWEN) | (1 << TWIE);
+}
+
+/*
+ * Description :
+ * End the running transaction with a stop, report it and start the next one.
+ */
+static void TWI_endTransaction(TWI_TransactionStatus status)
+{
+	TWI_TransactionType *transaction = g_queueHead;
+
+	SoftTimer_stop(g_stepTimer);
+	transaction->status = status;
+	transaction->error = (status == TWI_DONE) ? 0 : TWI_getStatus();
+	g_queueHead = transaction->next;
+	if(g_queueHead == NULL_PTR)
+	{
+		g_queueTail = NULL_PTR;
+		TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+	}
+	else
+	{
+		/* A stop followed directly by the start of the next transaction */
+		TWI_startTransaction(1 << TWSTO);
+	}
+
+	if(transaction->callBack != NULL_PTR)
+	{
+		(*transaction->callBack)(transaction);
+	}
+}
+
+/*
+ * Description :
+ * Call back of the step timer, runs from the tick interrupt when a step of the running
+ * transaction did not end in time: fail the transaction and stop the module. The clock
+ * sequence freeing the bus is too long for an interrupt, it runs from TWI_serviceRecovery()
+ * which then starts the next transaction.
+ */
+static void TWI_stepTimeout(void)
+{
+	TWI_TransactionType *transaction = g_queueHead;
+
+	if(transaction == NULL_PTR)
+	{
+		return;
+	}
+	TWI_countError(&g_errorCounters.timeout);
+	TWCR = 0;
+	g_recoveryPending = TRUE;
+
+	transaction->status = TWI_FAILED;
+	transaction->error = TWI_NO_INFO;
+	g_queueHead = transaction->next;
+	if(g_queueHead == NULL_PTR)
+	{
+		g_queueTail = NULL_PTR;
+	}
+
+	if(transaction->callBack != NULL_PTR)
+	{
+		(*transaction->callBack)(transaction);
+	}
+}
+
+/*
+ * Description :
+ * Read the next byte, acknowledged unless it is the last one.
+ */
+static void TWI_receiveNext(void)
+{
+	if((g_index + 1) < g_queueHead->readLength)
+	{
+		TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE);
+	}
+	else
+	{
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+	}
+}
+
+/*******************************************************************************
+ *                      Interrupt Service Routines                             *
+ *******************************************************************************/
+
+ISR(TWI_vect)
+{
+	TWI_TransactionType *transaction = g_queueHead;
+
+	if(transaction == NULL_PTR)
+	{
+		/* Nothing to run, release the bus */
+		TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+		return;
+	}
+
+	/* The step ended, give the next one its own time */
+	SoftTimer_start(g_stepTimer, TWI_STEP_TIMEOUT_MS, SOFT_TIMER_ONE_SHOT);
+
+	switch(TWI_getStatus())
+	{
+	case TWI_START:
+		if((transaction->writeLength != 0) || (transaction->readLength == 0))
+		{
+			TWDR = transaction->slaveAddress;
+		}
+		else
+		{
+			TWDR = transaction->slaveAddress | 1;
+		}
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		break;
+
+	case TWI_REP_START:
+		g_index = 0;
+		TWDR = transaction->slaveAddress | 1;
+		TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		break;
+
+	case TWI_MT_SLA_W_ACK:
+	case TWI_MT_DATA_ACK:
+		if(g_index < transaction->writeLength)
+		{
+			TWDR = transaction->writeData[g_index++];
+			TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWIE);
+		}
+		else if(transaction->readLength != 0)
+		{
+			TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN) | (1 << TWIE);
+		}
+		else
+		{
+			TWI_endTransaction(TWI_DONE);
+		}
+		break;
+
+	case TWI_MT_SLA_R_ACK:
+		if(transaction->readLength == 0)
+		{
+			TWI_endTransaction(TWI_DONE);
+		}
+		else
+		{
+			TWI_receiveNext();
+		}
+		break;
+
+	case TWI_MR_DATA_ACK:
+		transaction->readData[g_index++] = TWDR;
+		TWI_receiveNext();
+		break;
+
+	case TWI_MR_DATA_NACK:
+		transaction->readData[g_index++] = TWDR;
+		TWI_endTransaction(TWI_DONE);
+		break;
+
+	case TWI_BUS_ERROR:
+		/* Illegal start or stop, the hardware releases the bus once TWSTO is written */
+		TWI_countError(&g_errorCounters.busError);
+		TWI_endTransaction(TWI_FAILED);
+		break;
+
+	case TWI_ARBITRATION_LOST:
+		TWI_countError(&g_errorCounters.busError);
+		TWI_endTransaction(TWI_FAILED);
+		break;
+
+	default:
+		/* No acknowledge from the slave */
+		TWI_countError(&g_errorCounters.nack);
+		TWI_endTransaction(TWI_FAILED);
+		break;
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
 
 void TWI_init(void)
 {
@@ -25,6 +272,11 @@ void TWI_init(void)
     TWAR = 0b00000010; // my address = 0x01 :) 
 	
     TWCR = (1<<TWEN); /* enable TWI */
+
+    if(g_stepTimer == SOFT_TIMER_INVALID)
+    {
+        g_stepTimer = SoftTimer_create(TWI_stepTimeout);
+    }
 }
 
 void TWI_start(void)
@@ -37,7 +289,10 @@ void TWI_start(void)
     TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
     
     /* Wait for TWINT flag set in TWCR Register (start bit is send successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+    if(!TWI_waitForStep())
+    {
+        TWI_recoverBus();
+    }
 }
 
 void TWI_stop(void)
@@ -48,6 +303,18 @@ void TWI_stop(void)
 	 * Enable TWI Module TWEN=1 
 	 */
     TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+
+    /* Wait for TWSTO to be cleared by the hardware (stop bit is send successfully) */
+    uint32 start = Tick_getMs();
+    while(BIT_IS_SET(TWCR,TWSTO))
+    {
+        if(Tick_isElapsed(start, TWI_STEP_TIMEOUT_MS))
+        {
+            TWI_countError(&g_errorCounters.timeout);
+            TWI_recoverBus();
+            break;
+        }
+    }
 }
 
 void TWI_writeByte(uint8 data)
@@ -60,7 +327,10 @@ void TWI_writeByte(uint8 data)
 	 */ 
     TWCR = (1 << TWINT) | (1 << TWEN);
     /* Wait for TWINT flag set in TWCR Register(data is send successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+    if(!TWI_waitForStep())
+    {
+        TWI_recoverBus();
+    }
 }
 
 uint8 TWI_readByteWithACK(void)
@@ -72,7 +342,10 @@ uint8 TWI_readByteWithACK(void)
 	 */ 
     TWCR = (1 << TWINT) | (1 << TWEN) | (1 << TWEA);
     /* Wait for TWINT flag set in TWCR Register (data received successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+    if(!TWI_waitForStep())
+    {
+        TWI_recoverBus();
+    }
     /* Read Data */
     return TWDR;
 }
@@ -85,7 +358,10 @@ uint8 TWI_readByteWithNACK(void)
 	 */
     TWCR = (1 << TWINT) | (1 << TWEN);
     /* Wait for TWINT flag set in TWCR Register (data received successfully) */
-    while(BIT_IS_CLEAR(TWCR,TWINT));
+    if(!TWI_waitForStep())
+    {
+        TWI_recoverBus();
+    }
     /* Read Data */
     return TWDR;
 }
@@ -97,3 +373,173 @@ uint8 TWI_getStatus(void)
     status = TWSR & 0xF8;
     return status;
 }
+
+/*
+ * Description :
+ * Queue a transaction for the interrupt driven engine and return at once.
+ * Completion is reported by the status of the transaction and its call back.
+ * Returns FALSE if the transaction is already queued or running.
+ * The polling functions above must not be used while the engine is busy.
+ */
+bool TWI_submit(TWI_TransactionType *transaction)
+{
+	uint8 sreg = SREG;
+
+	if((transaction->status == TWI_QUEUED) || (transaction->status == TWI_BUSY))
+	{
+		return FALSE;
+	}
+
+	transaction->status = TWI_QUEUED;
+	transaction->error = 0;
+	transaction->next = NULL_PTR;
+
+	/* The interrupt takes transactions out of the queue */
+	cli();
+	if(g_queueHead == NULL_PTR)
+	{
+		g_queueHead = transaction;
+		g_queueTail = transaction;
+		if(!g_recoveryPending)
+		{
+			TWI_startTransaction(0);
+		}
+	}
+	else
+	{
+		g_queueTail->next = transaction;
+		g_queueTail = transaction;
+	}
+	SREG = sreg;
+
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return TRUE while the engine has transactions to run.
+ */
+bool TWI_isBusy(void)
+{
+	return g_queueHead != NULL_PTR;
+}
+
+/*
+ * Description :
+ * Queue a transaction and wait until it ends. Returns TWI_DONE or TWI_FAILED.
+ * A bus recovery needed meanwhile is run by the wait.
+ */
+TWI_TransactionStatus TWI_execute(TWI_TransactionType *transaction)
+{
+	if(!TWI_submit(transaction))
+	{
+		return TWI_FAILED;
+	}
+	while((transaction->status == TWI_QUEUED) || (transaction->status == TWI_BUSY))
+	{
+		TWI_serviceRecovery();
+	}
+	return transaction->status;
+}
+
+/*
+ * Description :
+ * Recover the bus after a step timeout and restart the queued transactions.
+ * Runs the clock sequence with busy waits: call it from a task, never from an interrupt.
+ */
+void TWI_serviceRecovery(void)
+{
+	uint8 sreg;
+
+	if(!g_recoveryPending)
+	{
+		return;
+	}
+	TWI_recoverBus();
+
+	sreg = SREG;
+	cli();
+	g_recoveryPending = FALSE;
+	if(g_queueHead != NULL_PTR)
+	{
+		TWI_startTransaction(0);
+	}
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Free a bus held by a slave: clock SCL until the slave releases SDA, send a stop
+ * and initialize the TWI module again.
+ */
+void TWI_recoverBus(void)
+{
+	uint8 i;
+
+	TWI_countError(&g_errorCounters.recovery);
+
+	/* Take the pins back from the TWI module, both released (input with pull up) */
+	TWCR = 0;
+	CLEAR_BIT(TWI_DDR,TWI_SCL);
+	CLEAR_BIT(TWI_DDR,TWI_SDA);
+	SET_BIT(TWI_PORT,TWI_SCL);
+	SET_BIT(TWI_PORT,TWI_SDA);
+
+	/* Clock until the slave has shifted out the byte it was sending and releases SDA */
+	for(i = 0; (i < TWI_RECOVERY_CLOCKS) && BIT_IS_CLEAR(TWI_PIN,TWI_SDA); i++)
+	{
+		CLEAR_BIT(TWI_PORT,TWI_SCL);
+		SET_BIT(TWI_DDR,TWI_SCL);           /* SCL low */
+		_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+		CLEAR_BIT(TWI_DDR,TWI_SCL);
+		SET_BIT(TWI_PORT,TWI_SCL);          /* SCL released */
+		_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	}
+
+	/* Stop condition: SDA rises while SCL is high */
+	CLEAR_BIT(TWI_PORT,TWI_SCL);
+	SET_BIT(TWI_DDR,TWI_SCL);               /* SCL low */
+	CLEAR_BIT(TWI_PORT,TWI_SDA);
+	SET_BIT(TWI_DDR,TWI_SDA);               /* SDA low */
+	_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	CLEAR_BIT(TWI_DDR,TWI_SCL);
+	SET_BIT(TWI_PORT,TWI_SCL);              /* SCL released */
+	_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+	CLEAR_BIT(TWI_DDR,TWI_SDA);
+	SET_BIT(TWI_PORT,TWI_SDA);              /* SDA released */
+	_delay_us(TWI_RECOVERY_HALF_PERIOD_US);
+
+	TWI_init();
+}
+
+/*
+ * Description :
+ * Copy the bus error counters.
+ */
+void TWI_getErrorCounters(TWI_ErrorCountersType *counters)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	counters->nack = g_errorCounters.nack;
+	counters->busError = g_errorCounters.busError;
+	counters->timeout = g_errorCounters.timeout;
+	counters->recovery = g_errorCounters.recovery;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Clear the bus error counters.
+ */
+void TWI_clearErrorCounters(void)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	g_errorCounters.nack = 0;
+	g_errorCounters.busError = 0;
+	g_errorCounters.timeout = 0;
+	g_errorCounters.recovery = 0;
+	SREG = sreg;
+}
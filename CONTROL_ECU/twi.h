@@ -27,10 +27,74 @@
 #define TWI_MT_DATA_ACK   0x28 /* Master transmit data and ACK has been received from Slave. */
 #define TWI_MR_DATA_ACK   0x50 /* Master received data and send ACK to slave. */
 #define TWI_MR_DATA_NACK  0x58 /* Master received data but doesn't send ACK to slave. */
+#define TWI_ARBITRATION_LOST 0x38 /* Arbitration lost while sending an address or data. */
+#define TWI_NO_INFO       0xF8 /* No relevant state, the error of a transaction that timed out. */
+#define TWI_BUS_ERROR     0x00 /* Illegal start or stop condition. */
+
+/* Longest time one bus step (start, one byte, stop) may take before the bus is recovered */
+#define TWI_STEP_TIMEOUT_MS 2
+
+/* TWI pins, driven by hand to make a slave release SDA */
+#define TWI_PORT          PORTC
+#define TWI_DDR           DDRC
+#define TWI_PIN           PINC
+#define TWI_SCL           PC0
+#define TWI_SDA           PC1
+
+/* Number of clocks sent to a slave holding SDA low, enough to finish the byte it sends */
+#define TWI_RECOVERY_CLOCKS 9
+
+/* Half period of the recovery clock (100 kHz) */
+#define TWI_RECOVERY_HALF_PERIOD_US 5
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef enum
+{
+	TWI_IDLE,TWI_QUEUED,TWI_BUSY,TWI_DONE,TWI_FAILED
+}TWI_TransactionStatus;
+
+/*
+ * A transaction executed by the TWI_vect engine:
+ * start, SLA+W, writeLength bytes, then if readLength != 0 a repeated start,
+ * SLA+R and readLength bytes (ACK on all but the last), then stop.
+ * With writeLength = 0 the transaction starts directly with SLA+R, with both lengths 0
+ * it is only SLA+W and stop (to check that the slave acknowledges).
+ * The structure and its buffers belong to the caller and must stay valid until
+ * the status is TWI_DONE or TWI_FAILED. A new transaction starts with status TWI_IDLE.
+ */
+typedef struct TWI_Transaction
+{
+	uint8 slaveAddress;                 /* SLA+W: 7 bits address shifted left, R/W bit = 0 */
+	const uint8 *writeData;
+	uint8 writeLength;
+	uint8 *readData;
+	uint8 readLength;
+	void (*callBack)(struct TWI_Transaction *transaction); /* called from the interrupt at the end, may be NULL_PTR */
+	volatile TWI_TransactionStatus status;
+	volatile uint8 error;               /* TWI status that failed the transaction */
+	struct TWI_Transaction *next;       /* used by the queue */
+}TWI_TransactionType;
+
+/* Bus errors counted since the last TWI_clearErrorCounters(), saturated at 0xFF */
+typedef struct
+{
+	uint8 nack;         /* the slave did not acknowledge its address or a byte */
+	uint8 busError;     /* illegal start/stop or lost arbitration */
+	uint8 timeout;      /* a step did not end within TWI_STEP_TIMEOUT_MS */
+	uint8 recovery;     /* the bus was recovered with the clock sequence */
+}TWI_ErrorCountersType;
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
+/*
+ * Description :
+ * Initialize the TWI module. The engine timeouts need the system tick (Tick_init)
+ * to be started before.
+ */
 void TWI_init(void);
 void TWI_start(void);
 void TWI_stop(void);
@@ -39,5 +103,54 @@ uint8 TWI_readByteWithACK(void);
 uint8 TWI_readByteWithNACK(void);
 uint8 TWI_getStatus(void);
 
+/*
+ * Description :
+ * Queue a transaction for the interrupt driven engine and return at once.
+ * Completion is reported by the status of the transaction and its call back.
+ * Returns FALSE if the transaction is already queued or running.
+ * The polling functions above must not be used while the engine is busy.
+ */
+bool TWI_submit(TWI_TransactionType *transaction);
+
+/*
+ * Description :
+ * Return TRUE while the engine has transactions to run.
+ */
+bool TWI_isBusy(void);
+
+/*
+ * Description :
+ * Queue a transaction and wait until it ends. Returns TWI_DONE or TWI_FAILED.
+ * A bus recovery needed meanwhile is run by the wait.
+ */
+TWI_TransactionStatus TWI_execute(TWI_TransactionType *transaction);
+
+/*
+ * Description :
+ * Recover the bus after a step timeout and restart the queued transactions.
+ * Runs the clock sequence with busy waits: call it from a task, never from an interrupt.
+ * Only needed by users of TWI_submit() that do not wait with TWI_execute().
+ */
+void TWI_serviceRecovery(void);
+
+/*
+ * Description :
+ * Free a bus held by a slave: clock SCL until the slave releases SDA, send a stop
+ * and initialize the TWI module again.
+ */
+void TWI_recoverBus(void);
+
+/*
+ * Description :
+ * Copy the bus error counters.
+ */
+void TWI_getErrorCounters(TWI_ErrorCountersType *counters);
+
+/*
+ * Description :
+ * Clear the bus error counters.
+ */
+void TWI_clearErrorCounters(void);
+
 
 #endif /* TWI_H_ */
@@ -5,28 +5,37 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../DoorLocker_HMI_ECU.c \
+../frame.c \
 ../gpio.c \
 ../internal_eeprom.c \
 ../keypad.c \
 ../lcd.c \
+../link.c \
+../protocol.c \
 ../timer.c \
 ../uart.c 
 
 OBJS += \
 ./DoorLocker_HMI_ECU.o \
+./frame.o \
 ./gpio.o \
 ./internal_eeprom.o \
 ./keypad.o \
 ./lcd.o \
+./link.o \
+./protocol.o \
 ./timer.o \
 ./uart.o 
 
 C_DEPS += \
 ./DoorLocker_HMI_ECU.d \
+./frame.d \
 ./gpio.d \
 ./internal_eeprom.d \
 ./keypad.d \
 ./lcd.d \
+./link.d \
+./protocol.d \
 ./timer.d \
 ./uart.d 
 
@@ -13,6 +13,8 @@
 #include "lcd.h"
 #include "keypad.h"
 #include "uart.h"
+#include "link.h"
+#include "protocol.h"
 
 #include "timer.h"
 #include "common_macros.h"
@@ -24,29 +26,28 @@
 /*       declaration of varaibales    */
 
 
-/* global variable contain the ticks count of the timer */
-uint8 g_tick = 0;
+/* Maximum number of digits in a password, limited by the LCD width */
+#define PASSWORD_MAX_LENGTH	16
 
-/* global variable flag to indicate finish of counting desired number of seconds */
-uint8 g_FinshedCounting = 0;
+/* Time between two door status requests while the door moves */
+#define DOOR_STATUS_POLL_MS	250
 
-/* Handshaking definitions*/
-#define MC1_READY 6
-#define MC2_READY 7
+/* Unanswered door status requests after which the door progress screen is left */
+#define DOOR_STATUS_MAX_FAILURES	3
 
-/* MC1 functions */
-#define SetNewPasswordFn	9
-#define GetOptionsFn		1
-#define EnterPasswordFn		2
-#define SetFirstPasswordFn	5
+/* Time a wrong password is displayed while waiting for the alarm countdown of MC2 */
+#define WRONG_PASSWORD_DISPLAY_MS	1000
 
-/* MC2 functions */
-#define ChangePasswordFn	3
-#define OpenDoorFn			4
+/* The lockout screen is left if MC2 stops sending its countdown (sent every second) */
+#define ALARM_COUNTDOWN_TIMEOUT_MS	3000
 
+/* Keys of the audit log screen */
+#define AUDIT_NEWER_KEY	'+'
+#define AUDIT_OLDER_KEY	'-'
+#define AUDIT_EXIT_KEY	'='
 
-/* Defined for timer number of compares */
-#define NUMBER_OF_COMPARE_MTACHES_PER_SECOND 31
+/* Hours of the entry time are displayed with at most 3 digits */
+#define AUDIT_MAX_DISPLAY_HOURS	999
 
 #define NULL_PTR    ((void*)0)
 
@@ -56,66 +57,100 @@ uint8 g_FinshedCounting = 0;
  *******************************************************************************/
 
 /* Description:
- * Function used for displaying the steps of changing the password on the LCD
+ * Function used for:
+ *  Getting the entered password from the keypad
+ * INPUTS:
+ * 		uint8 * Password: array of PASSWORD_MAX_LENGTH digits where the password is saved
+ * OUTPUTS:
+ * 		uint8: number of entered digits
+ */
+uint8 GetPassword(uint8 * Password);
+
+/* Description:
+ * Function used for displaying the main menu on the LCD
  * INPUTS:	N/A
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8 key: the chosen option ('+', '-' or '*')
  */
-void ChangePassword (void);
+uint8 GetOptions (void);
 
 /* Description:
  * Function used for:
- *  Getting the entered password from the keypad
- * 	Sending the entered password to MC2
+ *  Displaying the passwords entry screens
+ *  Checking the returned decision from comparing both entries at MC2,
+ *  a mismatch ends the attempt as MC2 then needs the current password again
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
-void GetPassword(void);
+void SetNewPassword (void);
 
 /* Description:
- * Function used for displaying the main menu on the LCD
+ * Function used for:
+ *  Getting the entered password from the keypad
+ * 	Sending the entered password to MC2 and receiving its decision
+ * INPUTS:
+ * 		uint8 MessageType: the request carrying the password (MSG_NEW_PASSWORD or MSG_CONFIRM_PASSWORD)
+ * OUTPUTS:
+ * 		uint8 Decision: the returned decision value from MC2, FALSE if it did not answer
+ */
+uint8 SendPassword(uint8 MessageType);
+
+/* Description:
+ * Function used for:
+ *  Getting the entered password from the keypad
+ * 	Sending the chosen action and the password to MC2 in one request and receiving its decision
+ * INPUTS:
+ * 		uint8 Action: the chosen option (UNLOCK_OPEN_DOOR, UNLOCK_CHANGE_PASSWORD or UNLOCK_AUDIT_LOG)
+ * OUTPUTS:
+ * 		uint8 Decision: TRUE if MC2 accepted the password and started the action
+ */
+uint8 SendUnlockRequest(uint8 Action);
+
+/* Description:
+ * Function used for asking MC2 to negotiate a faster baud rate on the link
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
-void GetOptions (void);
+void NegotiateLink(void);
 
 /* Description:
  * Function used for:
- *  Displaying the passwords entry screens
- *  Checking the returned decision from comparing both entries at MC2
+ *  Asking MC2 for the door phase until the door is locked again
+ * 	Displaying the phase and the seconds left in it
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
-void SetNewPassword (void);
+void ShowDoorProgress(void);
 
 /* Description:
  * Function used for:
- * 	Receiving the decision returned from MC2
+ *  Waiting for the alarm countdown MC2 sends after 3 consecutive wrong passwords
+ * 	Displaying the seconds left in the lockout until the alarm is over
  * INPUTS:	N/A
- * OUTPUTS:
- * 		uint8 Decision: the returned decision value from MC2
+ * OUTPUTS:	N/A
  */
-uint8 CheckDecision(void);
-
-void InformMC2(uint8 SelectedFn);
+void ShowLockout(void);
 
 /* Description:
  * Function used for:
- *  Interrupt Service Routine for timer0 compare mode
- *  Set g_FinshedCounting flag to 1 every 1 second
+ *  Reading the audit log from MC2, AUDIT_DUMP_MAX_ENTRIES entries per request
+ * 	Displaying one entry at a time from the newest one on, '+' and '-' page through them and '=' leaves,
+ * 	MC2 only answers right after the password was checked for UNLOCK_AUDIT_LOG
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
-void TickCounter(void);
+void ShowAuditLog(void);
 
 /* Description:
- * Function used for:
- *  Initializing Timer0 with the desired values
- *  Loop until reaching the desired number of delayed seconds
+ * Function used for displaying an entry of the audit log: its event, its position in the log
+ *  and the time since boot it was made at
  * INPUTS:
- * 		uint8 Seconds: Number of desired seconds to delay
+ * 		const uint8 * Entry: the entry as received in MSG_AUDIT_DUMP
+ * 		uint8 Index: position of the entry in the log, 0 the oldest
+ * 		uint8 Count: number of entries in the log
  * OUTPUTS:	N/A
  */
-void CountByTimer1(uint8 Seconds);
+void DisplayAuditEntry(const uint8 * Entry, uint8 Index, uint8 Count);
 
 
 
@@ -123,54 +158,60 @@ int main(void)
 {
 
 	LCD_init();			/* Initialize LCD driver*/
+	Tick_init();		/* Start the system tick used for the protocol timeouts */
 
-	/* Initialize the UART driver with Baud-rate = 9600 bits/sec, 1 stop bit, disabled parity and 8 bit character */
-	UART_ConfigType UART_Structure={EIGHT_BIT,DISABLED,ONE_BIT,9600};
-	UART_init(&UART_Structure);
+	/* Initialize the UART driver at the link base rate then step up to the fastest rate MC2 handles */
+	LINK_init();
+	PROTOCOL_init();
+	NegotiateLink();
 
 	uint8 Decision;		/*Variable to store the received decision from MC2 */
-	/*To set a password for the system at first use */
-	UART_sendByte(SetFirstPasswordFn);
-	Decision = UART_recieveByte();
-	if (Decision==TRUE)
-	{
+	uint8 key;			/*Variable to store the chosen option */
 
+	/*To set a password for the system at first use, ask until MC2 is running */
+	while(!PROTOCOL_request(MSG_PASSWORD_STATUS, NULL_PTR, 0, &Decision, 1, NULL_PTR)){}
+	/* MC2 may have booted after the first negotiation, it is surely running now */
+	if(LINK_getBaudRate() == LINK_BASE_BAUD)
+	{
+		NegotiateLink();
 	}
-	else{
-	SetNewPassword ();
+	/* A failed attempt ends the change at MC2, asking the status again allows the next one until a password is saved */
+	while (Decision != TRUE)
+	{
+		SetNewPassword ();
+		while(!PROTOCOL_request(MSG_PASSWORD_STATUS, NULL_PTR, 0, &Decision, 1, NULL_PTR)){}
 	}
 
 
 	while(1){
-		GetOptions();
-		Decision = UART_recieveByte();
-		switch (Decision){
-		case OpenDoorFn:
+		/* Too many line errors made the link fall back, try the slower rates again */
+		if(LINK_monitor())
+		{
+			NegotiateLink();
+		}
 
-			InformMC2(EnterPasswordFn);
-			LCD_clearScreen();
-			LCD_displayStringRowColumn(0,0,"Enter password:");
-			GetPassword();
+		key = GetOptions();
+		LCD_clearScreen();
+		LCD_displayStringRowColumn(0,0,"Enter password:");
+		Decision = SendUnlockRequest(key);
+
+		switch (key){
+		case UNLOCK_OPEN_DOOR:
 
-			if(CheckDecision())
+			if(Decision)
 			{
-				LCD_clearScreen();
-				LCD_displayStringRowColumn(0,0,"Opening the door");
-				CountByTimer1(33);
+				ShowDoorProgress();
 			}
 			else
 			{
 				LCD_clearScreen();
 				LCD_displayStringRowColumn(0,0,"Wrong password");
-				_delay_ms(1000);
+				ShowLockout();
 			}
 			break;
 
-		case ChangePasswordFn:
-			LCD_clearScreen();
-			LCD_displayStringRowColumn(0,0,"Enter password:");
-			GetPassword();
-			if(CheckDecision())
+		case UNLOCK_CHANGE_PASSWORD:
+			if(Decision)
 			{
 				SetNewPassword ();
 			}
@@ -178,54 +219,48 @@ int main(void)
 			{
 				LCD_clearScreen();
 				LCD_displayStringRowColumn(0,0,"Wrong password");
-				_delay_ms(1000);
+				ShowLockout();
 				break;
 			}
+			break;
+
+		case UNLOCK_AUDIT_LOG:
+			if(Decision)
+			{
+				ShowAuditLog();
+			}
+			else
+			{
+				LCD_clearScreen();
+				LCD_displayStringRowColumn(0,0,"Wrong password");
+				ShowLockout();
+			}
+			break;
 		}
 
 	}
 }
 /********************************************************************************************************/
 
-/* Description:
- * Function used for displaying the steps of changing the password on the LCD
- * INPUTS:	N/A
- * OUTPUTS:	N/A
- */
-
-void ChangePassword (void)
-{
-
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0,0,"Enter new pass:");
-	GetPassword();
-	_delay_ms(500);
-	LCD_clearScreen();
-	LCD_displayStringRowColumn(0,0,"Renter new pass:");
-	GetPassword();
-
-}
-/********************************************************************************************************/
-
 
 /* Description:
  * Function used for:
  *  Getting the entered password from the keypad
- * 	Sending the entered password to MC2
- * INPUTS:	N/A
- * OUTPUTS:	N/A
+ * INPUTS:
+ * 		uint8 * Password: array of PASSWORD_MAX_LENGTH digits where the password is saved
+ * OUTPUTS:
+ * 		uint8: number of entered digits
  */
 
-void GetPassword(void)
+uint8 GetPassword(uint8 * Password)
 {
-	uint8 Password[17];
 	uint8 key;
 	uint8 counter = 0;
 	do
 	{
 		key = KEYPAD_getPressedKey();
 
-		if((key >= 0) && (key <= 9))
+		if((key >= 0) && (key <= 9) && (counter < PASSWORD_MAX_LENGTH))
 		{
 			Password[counter]=key+48;
 			LCD_displayStringRowColumn(1,counter,"*");
@@ -234,134 +269,336 @@ void GetPassword(void)
 		}
 	}
 	while(key != '=');
-	Password[counter]= '#';
-	Password[counter+1]= NULL_PTR ;
 
-	/* Wait until MC2 is ready to receive the string */
-	while(UART_recieveByte() != MC2_READY){}
-	UART_sendString(Password);
+	return counter;
 }
 /********************************************************************************************************/
 
 /* Description:
  * Function used for displaying the main menu on the LCD
  * INPUTS:	N/A
- * OUTPUTS:	N/A
+ * OUTPUTS:
+ * 		uint8 key: the chosen option ('+', '-' or '*')
  */
 
-void GetOptions (void)
+uint8 GetOptions (void)
 {
-	UART_sendByte(GetOptionsFn);	/* Inform MC2 of selected function */
-
 	uint8 key;
 	LCD_clearScreen();
-	LCD_displayStringRowColumn(0,0,"+ : Open door");
-	LCD_displayStringRowColumn(1,0,"- : Change pass");
+	LCD_displayStringRowColumn(0,0,"+:Open -:Change");
+	LCD_displayStringRowColumn(1,0,"*:Access log");
 	do{
 	key = KEYPAD_getPressedKey();
-	if((key == '+') || (key == '-'))
-	{
-
-		UART_sendByte(key);
-	}
-	}while((key != '+') && (key != '-'));
+	}while((key != UNLOCK_OPEN_DOOR) && (key != UNLOCK_CHANGE_PASSWORD) && (key != UNLOCK_AUDIT_LOG));
+	return key;
 }
 /********************************************************************************************************/
 
 /* Description:
  * Function used for:
  *  Displaying the passwords entry screens
- *  Checking the returned decision from comparing both entries at MC2
+ *  Checking the returned decision from comparing both entries at MC2,
+ *  a mismatch ends the attempt as MC2 then needs the current password again
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
 
 void SetNewPassword (void)
 {
-	uint8 Decision;
-	do{
-		InformMC2(SetNewPasswordFn);
-		ChangePassword();
-		Decision = CheckDecision();
-		if (!Decision){
-			LCD_clearScreen();
-			LCD_displayStringRowColumn(0,0,"Error: mismatch");
-			_delay_ms(1000);
-		}
-	}while(!Decision );
+	LCD_clearScreen();
+	LCD_displayStringRowColumn(0,0,"Enter new pass:");
+	if(!SendPassword(MSG_NEW_PASSWORD))
+	{
+		/* MC2 refused the change or did not answer */
+		LCD_clearScreen();
+		LCD_displayStringRowColumn(0,0,"Request failed");
+		_delay_ms(1000);
+		return;
+	}
+	LCD_clearScreen();
+	LCD_displayStringRowColumn(0,0,"Renter new pass:");
+	if (!SendPassword(MSG_CONFIRM_PASSWORD)){
+		LCD_clearScreen();
+		LCD_displayStringRowColumn(0,0,"Error: mismatch");
+		_delay_ms(1000);
+	}
 }
 /********************************************************************************************************/
 
 /* Description:
  * Function used for:
- * 	Receiving the decision returned from MC2
- * INPUTS:	N/A
+ *  Getting the entered password from the keypad
+ * 	Sending the entered password to MC2 and receiving its decision
+ * INPUTS:
+ * 		uint8 MessageType: the request carrying the password (MSG_NEW_PASSWORD or MSG_CONFIRM_PASSWORD)
  * OUTPUTS:
- * 		uint8 Decision: the returned decision value from MC2
+ * 		uint8 Decision: the returned decision value from MC2, FALSE if it did not answer
  */
 
+uint8 SendPassword(uint8 MessageType)
+{
+	uint8 Password[PASSWORD_MAX_LENGTH];
+	uint8 Length, Decision;
+
+	Length = GetPassword(Password);
+	if(!PROTOCOL_request(MessageType, Password, Length, &Decision, 1, NULL_PTR))
+	{
+		return FALSE;	/* MC2 did not answer, handled like a rejected request */
+	}
+	return Decision;
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for:
+ *  Getting the entered password from the keypad
+ * 	Sending the chosen action and the password to MC2 in one request and receiving its decision
+ * INPUTS:
+ * 		uint8 Action: the chosen option (UNLOCK_OPEN_DOOR, UNLOCK_CHANGE_PASSWORD or UNLOCK_AUDIT_LOG)
+ * OUTPUTS:
+ * 		uint8 Decision: TRUE if MC2 accepted the password and started the action
+ */
 
-uint8 CheckDecision(void)
+uint8 SendUnlockRequest(uint8 Action)
 {
-	uint8 Decision;
-	Decision = UART_recieveByte();
+	uint8 Request[1 + PASSWORD_MAX_LENGTH];	/* Action followed by the password digits */
+	uint8 Length, Decision;
+
+	Request[0] = Action;
+	Length = GetPassword(&Request[1]);
+	if(!PROTOCOL_request(MSG_UNLOCK, Request, 1 + Length, &Decision, 1, NULL_PTR))
+	{
+		return FALSE;	/* MC2 did not answer, handled like a rejected request */
+	}
 	return Decision;
 }
 /********************************************************************************************************/
 
-void InformMC2(uint8 SelectedFn)
+/* Description:
+ * Function used for asking MC2 to negotiate a faster baud rate on the link
+ * INPUTS:	N/A
+ * OUTPUTS:	N/A
+ */
+
+void NegotiateLink(void)
 {
-	UART_sendByte(SelectedFn);
+	uint8 Accepted;
+
+	if(PROTOCOL_request(MSG_LINK_NEGOTIATE, NULL_PTR, 0, &Accepted, 1, NULL_PTR) && Accepted)
+	{
+		LINK_negotiateMaster();
+	}
 }
 /********************************************************************************************************/
 
+
 /* Description:
  * Function used for:
- *  Interrupt Service Routine for timer0 compare mode
- *  Set g_FinshedCounting flag to 1 every 1 second
+ *  Asking MC2 for the door phase until the door is locked again
+ * 	Displaying the phase and the seconds left in it
  * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
+void ShowDoorProgress(void)
+{
+	uint8 Status[2];			/* Door phase and seconds left in it */
+	uint8 Phase = DOOR_STATUS_LOCKED;
+	uint8 Failures = 0;
+
+	while(Failures < DOOR_STATUS_MAX_FAILURES)
+	{
+		if(!PROTOCOL_request(MSG_DOOR_STATUS, NULL_PTR, 0, Status, 2, NULL_PTR))
+		{
+			Failures++;
+			continue;
+		}
+		Failures = 0;
 
-void TickCounter(void)
+		if(Status[0] == DOOR_STATUS_LOCKED)
+		{
+			return;
+		}
+		if(Status[0] != Phase)
+		{
+			Phase = Status[0];
+			LCD_clearScreen();
+			switch(Phase){
+			case DOOR_STATUS_OPENING:
+				LCD_displayStringRowColumn(0,0,"Opening the door");
+				break;
+			case DOOR_STATUS_HELD:
+				LCD_displayStringRowColumn(0,0,"Door is open");
+				break;
+			default:
+				LCD_displayStringRowColumn(0,0,"Closing the door");
+				break;
+			}
+		}
+		LCD_goToRowColumn(1,0);
+		LCD_intgerToString(Status[1]);
+		LCD_displayString(" s ");
+		_delay_ms(DOOR_STATUS_POLL_MS);
+	}
+}
+/********************************************************************************************************/
+
+/* Description:
+ * Function used for:
+ *  Waiting for the alarm countdown MC2 sends after 3 consecutive wrong passwords
+ * 	Displaying the seconds left in the lockout until the alarm is over
+ * INPUTS:	N/A
+ * OUTPUTS:	N/A
+ */
+void ShowLockout(void)
 {
-	g_tick++;
-	if(g_tick == NUMBER_OF_COMPARE_MTACHES_PER_SECOND)
+	PROTOCOL_RequestType Notification;
+	uint32 Start = Tick_getMs();
+	uint32 Timeout = WRONG_PASSWORD_DISPLAY_MS;	/* Without an alarm the wrong password is just displayed */
+	bool Locked = FALSE;
+
+	while(!Tick_isElapsed(Start, Timeout))
 	{
-		g_FinshedCounting=1;
-		g_tick = 0; //clear the tick counter again to count a new second
+		if(!PROTOCOL_pollNotification(&Notification) ||
+				(Notification.type != MSG_ALARM_COUNTDOWN) || (Notification.length < 1))
+		{
+			continue;
+		}
+		if(Notification.payload[0] == 0)
+		{
+			return;
+		}
+		if(!Locked)
+		{
+			Locked = TRUE;
+			LCD_clearScreen();
+			LCD_displayStringRowColumn(0,0,"System locked");
+		}
+		LCD_displayCountdown(1,0,Notification.payload[0]);
+
+		/* Wait for the next second of the countdown */
+		Start = Tick_getMs();
+		Timeout = ALARM_COUNTDOWN_TIMEOUT_MS;
 	}
 }
 /********************************************************************************************************/
 
 /* Description:
  * Function used for:
- *  Initializing Timer0 with the desired values
- *  Loop until reaching the desired number of delayed seconds
- * INPUTS:
- * 		uint8 Seconds: Number of desired seconds to delay
+ *  Reading the audit log from MC2, AUDIT_DUMP_MAX_ENTRIES entries per request
+ * 	Displaying one entry at a time from the newest one on, '+' and '-' page through them and '=' leaves,
+ * 	MC2 only answers right after the password was checked for UNLOCK_AUDIT_LOG
+ * INPUTS:	N/A
  * OUTPUTS:	N/A
  */
-void CountByTimer1(uint8 Seconds)
+void ShowAuditLog(void)
 {
-	Timer1_DeInit();
-	Timer1_ConfigType Timer1_Structure={COMPARE,F_CPU_1024,0,250};
-	Timer1_init(&Timer1_Structure);
-	Timer1_setCallBack(TickCounter);
-	uint8 SecondsCounter=0;
-	while(1)
-    {
-
-		if(g_FinshedCounting==1){
-			SecondsCounter++;
-			g_FinshedCounting=0;
+	uint8 Response[1 + AUDIT_DUMP_MAX_ENTRIES * AUDIT_DUMP_ENTRY_SIZE];	/* Entries in the log, then the entries read */
+	uint8 Length;
+	uint8 Page = 0;			/* Index of the first entry in Response */
+	uint8 Received = 0;		/* Entries in Response */
+	uint8 Count;
+	uint8 Index;
+	uint8 key;
+
+	/* The first request gives the number of entries with the oldest ones */
+	if(!PROTOCOL_request(MSG_AUDIT_DUMP, &Page, 1, Response, sizeof(Response), &Length) || (Length < 1))
+	{
+		LCD_clearScreen();
+		LCD_displayStringRowColumn(0,0,"Request failed");
+		_delay_ms(1000);
+		return;
+	}
+	Count = Response[0];
+	Received = (Length - 1) / AUDIT_DUMP_ENTRY_SIZE;
+	if(Count == 0)
+	{
+		LCD_clearScreen();
+		LCD_displayStringRowColumn(0,0,"Log is empty");
+		_delay_ms(1000);
+		return;
+	}
+
+	Index = Count - 1;
+	do{
+		/* Read the page of the entry unless it is the one already received */
+		if((Index < Page) || (Index >= Page + Received))
+		{
+			Page = Index - (Index % AUDIT_DUMP_MAX_ENTRIES);
+			if(!PROTOCOL_request(MSG_AUDIT_DUMP, &Page, 1, Response, sizeof(Response), &Length) ||
+					(Length < 1) || (Index >= Page + (Length - 1) / AUDIT_DUMP_ENTRY_SIZE))
+			{
+				LCD_clearScreen();
+				LCD_displayStringRowColumn(0,0,"Request failed");
+				_delay_ms(1000);
+				return;
+			}
+			Received = (Length - 1) / AUDIT_DUMP_ENTRY_SIZE;
 		}
+		DisplayAuditEntry(&Response[1 + (Index - Page) * AUDIT_DUMP_ENTRY_SIZE], Index, Count);
 
-		if(SecondsCounter==Seconds){
-			SecondsCounter=0;
-			Timer1_DeInit();
-			return;
+		do{
+		key = KEYPAD_getPressedKey();
+		}while((key != AUDIT_NEWER_KEY) && (key != AUDIT_OLDER_KEY) && (key != AUDIT_EXIT_KEY));
+		if((key == AUDIT_NEWER_KEY) && (Index + 1 < Count))
+		{
+			Index++;
+		}
+		else if((key == AUDIT_OLDER_KEY) && (Index > 0))
+		{
+			Index--;
 		}
-    }
+		_delay_ms(500);
+	}while(key != AUDIT_EXIT_KEY);
 }
+/********************************************************************************************************/
 
+/* Description:
+ * Function used for displaying an entry of the audit log: its event, its position in the log
+ *  and the time since boot it was made at
+ * INPUTS:
+ * 		const uint8 * Entry: the entry as received in MSG_AUDIT_DUMP
+ * 		uint8 Index: position of the entry in the log, 0 the oldest
+ * 		uint8 Count: number of entries in the log
+ * OUTPUTS:	N/A
+ */
+void DisplayAuditEntry(const uint8 * Entry, uint8 Index, uint8 Count)
+{
+	uint32 Seconds = (uint32)Entry[4] | ((uint32)Entry[5] << 8) | ((uint32)Entry[6] << 16) | ((uint32)Entry[7] << 24);
+	uint32 Hours = Seconds / 3600;
+
+	LCD_clearScreen();
+	switch(Entry[2]){
+	case AUDIT_EVENT_BOOT:
+		LCD_displayStringRowColumn(0,0,"Boot");
+		break;
+	case AUDIT_EVENT_UNLOCK:
+		LCD_displayStringRowColumn(0,0,"Unlock");
+		break;
+	case AUDIT_EVENT_WRONG_PASSWORD:
+		LCD_displayStringRowColumn(0,0,"Wrong password");
+		break;
+	case AUDIT_EVENT_LOCKOUT:
+		LCD_displayStringRowColumn(0,0,"Lockout");
+		break;
+	case AUDIT_EVENT_PASSWORD_CHANGE:
+		LCD_displayStringRowColumn(0,0,"Password change");
+		break;
+	default:
+		LCD_displayStringRowColumn(0,0,"Unknown event");
+		break;
+	}
+
+	/* Position from the oldest entry on, then the time since boot as hours and MM:SS */
+	LCD_goToRowColumn(1,0);
+	LCD_intgerToString(Index + 1);
+	LCD_displayString("/");
+	LCD_intgerToString(Count);
+	if(Hours > AUDIT_MAX_DISPLAY_HOURS)
+	{
+		Hours = AUDIT_MAX_DISPLAY_HOURS;
+	}
+	LCD_goToRowColumn(1,7);
+	LCD_intgerToString((int)Hours);
+	LCD_displayString("h");
+	LCD_displayCountdown(1,11,(uint16)(Seconds % 3600));
+}
@@ -0,0 +1,255 @@
+/******************************************************************************
+ *
+ * Module: FRAME
+ *
+ * File Name: frame.c
+ *
+ * Description: Source file for the framing layer used on the UART link between
+ * the HMI ECU and the Control ECU.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "frame.h"
+#include "uart.h"
+#include "timer.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Number of frames rejected for a wrong CRC or length */
+static uint8 g_rejectedCount = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Count a rejected frame and return the reason it was rejected.
+ */
+static FRAME_Status FRAME_reject(FRAME_Status status)
+{
+	if(g_rejectedCount != FRAME_MAX_ERROR_COUNT)
+	{
+		g_rejectedCount++;
+	}
+	return status;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update a CRC-8 (polynomial 0x07) with one byte.
+ */
+uint8 FRAME_crc8(uint8 crc, uint8 data)
+{
+	uint8 bit;
+
+	crc ^= data;
+	for(bit = 0; bit < 8; bit++)
+	{
+		if(crc & 0x80)
+		{
+			crc = (crc << 1) ^ 0x07;
+		}
+		else
+		{
+			crc <<= 1;
+		}
+	}
+	return crc;
+}
+
+/*
+ * Description :
+ * Send one frame of the given type and sequence number carrying length bytes of payload.
+ */
+void FRAME_send(uint8 type, uint8 seq, const uint8 *payload, uint8 length)
+{
+	uint8 i;
+	uint8 crc = 0;
+
+	UART_sendByte(FRAME_START_BYTE);
+
+	UART_sendByte(type);
+	crc = FRAME_crc8(crc, type);
+
+	UART_sendByte(seq);
+	crc = FRAME_crc8(crc, seq);
+
+	UART_sendByte(length);
+	crc = FRAME_crc8(crc, length);
+
+	for(i = 0; i < length; i++)
+	{
+		UART_sendByte(payload[i]);
+		crc = FRAME_crc8(crc, payload[i]);
+	}
+
+	UART_sendByte(crc);
+}
+
+/*
+ * Description :
+ * Prepare a receiver to place the payload of the next frame directly in buffer.
+ */
+void FRAME_initReceiver(FRAME_RxType *rx, uint8 *buffer, uint8 capacity)
+{
+	rx->buffer = buffer;
+	rx->capacity = capacity;
+	rx->type = 0;
+	rx->seq = 0;
+	rx->length = 0;
+	rx->state = FRAME_WAIT_START;
+	rx->index = 0;
+	rx->crc = 0;
+}
+
+/*
+ * Description :
+ * Consume the bytes waiting in the UART receive buffer without blocking.
+ * Returns FRAME_PENDING until a whole frame was received, then FRAME_OK or the
+ * reason the frame was rejected. The receiver is ready for the next frame afterwards.
+ */
+FRAME_Status FRAME_poll(FRAME_RxType *rx)
+{
+	uint8 data;
+
+	while(UART_tryReceiveByte(&data))
+	{
+		switch(rx->state)
+		{
+		case FRAME_WAIT_START:
+			/* Skip everything until the start of a frame */
+			if(data == FRAME_START_BYTE)
+			{
+				rx->crc = 0;
+				rx->state = FRAME_WAIT_TYPE;
+			}
+			break;
+
+		case FRAME_WAIT_TYPE:
+			rx->type = data;
+			rx->crc = FRAME_crc8(rx->crc, data);
+			rx->state = FRAME_WAIT_SEQ;
+			break;
+
+		case FRAME_WAIT_SEQ:
+			rx->seq = data;
+			rx->crc = FRAME_crc8(rx->crc, data);
+			rx->state = FRAME_WAIT_LENGTH;
+			break;
+
+		case FRAME_WAIT_LENGTH:
+			rx->length = data;
+			rx->index = 0;
+			rx->crc = FRAME_crc8(rx->crc, data);
+			if((data > rx->capacity) || (data > FRAME_MAX_PAYLOAD))
+			{
+				/* Payload does not fit the caller buffer, drop it together with its CRC */
+				rx->state = FRAME_DISCARD;
+			}
+			else if(data == 0)
+			{
+				rx->state = FRAME_WAIT_CRC;
+			}
+			else
+			{
+				rx->state = FRAME_WAIT_PAYLOAD;
+			}
+			break;
+
+		case FRAME_WAIT_PAYLOAD:
+			rx->buffer[rx->index] = data;
+			rx->index++;
+			rx->crc = FRAME_crc8(rx->crc, data);
+			if(rx->index == rx->length)
+			{
+				rx->state = FRAME_WAIT_CRC;
+			}
+			break;
+
+		case FRAME_WAIT_CRC:
+			rx->state = FRAME_WAIT_START;
+			return (data == rx->crc) ? FRAME_OK : FRAME_reject(FRAME_CRC_ERROR);
+
+		case FRAME_DISCARD:
+			/* The CRC byte is counted as well so the receiver ends just after the frame */
+			rx->index++;
+			if(rx->index > rx->length)
+			{
+				rx->state = FRAME_WAIT_START;
+				return FRAME_reject(FRAME_LENGTH_ERROR);
+			}
+			break;
+		}
+	}
+	return FRAME_PENDING;
+}
+
+/*
+ * Description :
+ * Wait until a whole frame was received and return FRAME_OK or the reason it was rejected.
+ */
+FRAME_Status FRAME_receive(FRAME_RxType *rx)
+{
+	FRAME_Status status;
+
+	do
+	{
+		status = FRAME_poll(rx);
+	}
+	while(status == FRAME_PENDING);
+
+	return status;
+}
+
+/*
+ * Description :
+ * Wait at most Timeout_ms milliseconds for a whole frame and return FRAME_OK, the reason
+ * it was rejected or FRAME_TIMEOUT. A frame cut by the timeout is dropped.
+ * Needs the system tick (Tick_init).
+ */
+FRAME_Status FRAME_receiveTimeout(FRAME_RxType *rx, uint32 Timeout_ms)
+{
+	FRAME_Status status;
+	uint32 start = Tick_getMs();
+
+	do
+	{
+		status = FRAME_poll(rx);
+		if((status == FRAME_PENDING) && Tick_isElapsed(start, Timeout_ms))
+		{
+			/* Resynchronise on the next start byte */
+			rx->state = FRAME_WAIT_START;
+			return FRAME_TIMEOUT;
+		}
+	}
+	while(status == FRAME_PENDING);
+
+	return status;
+}
+
+/*
+ * Description :
+ * Return the number of frames rejected for a wrong CRC or length (saturates at FRAME_MAX_ERROR_COUNT).
+ */
+uint8 FRAME_getErrorCount(void)
+{
+	return g_rejectedCount;
+}
+
+/*
+ * Description :
+ * Reset the counter of rejected frames.
+ */
+void FRAME_clearErrorCount(void)
+{
+	g_rejectedCount = 0;
+}
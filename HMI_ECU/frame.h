@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ * Module: FRAME
+ *
+ * File Name: frame.h
+ *
+ * Description: Header file for the framing layer used on the UART link between
+ * the HMI ECU and the Control ECU.
+ *
+ * Frame format:
+ *  +-------+------+-----+--------+-----------------+-----+
+ *  | START | TYPE | SEQ | LENGTH | PAYLOAD[LENGTH] | CRC |
+ *  +-------+------+-----+--------+-----------------+-----+
+ * SEQ is the sequence number used to match a response to its request.
+ * CRC is a CRC-8 (polynomial 0x07) over TYPE, SEQ, LENGTH and PAYLOAD.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* First byte of every frame, used to resynchronise the receiver */
+#define FRAME_START_BYTE 0x7E
+
+/* Largest payload a frame may carry */
+#define FRAME_MAX_PAYLOAD 32
+
+/* Value the counter of rejected frames saturates at */
+#define FRAME_MAX_ERROR_COUNT 0xFF
+
+/* Frame types, the application message types are listed in protocol.h */
+#define FRAME_NACK 0x01 /* A frame was received with a wrong CRC or length */
+
+/* Link management frame types (see link.h) */
+#define FRAME_LINK_PROPOSE 0x10
+#define FRAME_LINK_ACCEPT  0x11
+#define FRAME_LINK_PROBE   0x12
+#define FRAME_LINK_COMMIT  0x13
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef enum
+{
+	FRAME_PENDING, FRAME_OK, FRAME_CRC_ERROR, FRAME_LENGTH_ERROR, FRAME_TIMEOUT
+}FRAME_Status;
+
+typedef enum
+{
+	FRAME_WAIT_START, FRAME_WAIT_TYPE, FRAME_WAIT_SEQ, FRAME_WAIT_LENGTH, FRAME_WAIT_PAYLOAD, FRAME_WAIT_CRC, FRAME_DISCARD
+}FRAME_RxState;
+
+typedef struct
+{
+	uint8 *buffer;       /* Caller buffer the payload is received into */
+	uint8 capacity;      /* Size of the caller buffer */
+	uint8 type;          /* Type of the received frame */
+	uint8 seq;           /* Sequence number of the received frame */
+	uint8 length;        /* Payload length of the received frame */
+	FRAME_RxState state; /* Receiver internal state */
+	uint8 index;         /* Number of payload bytes received so far */
+	uint8 crc;           /* Running CRC of the frame being received */
+}FRAME_RxType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Update a CRC-8 (polynomial 0x07) with one byte.
+ */
+uint8 FRAME_crc8(uint8 crc, uint8 data);
+
+/*
+ * Description :
+ * Send one frame of the given type and sequence number carrying length bytes of payload.
+ */
+void FRAME_send(uint8 type, uint8 seq, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Prepare a receiver to place the payload of the next frame directly in buffer.
+ */
+void FRAME_initReceiver(FRAME_RxType *rx, uint8 *buffer, uint8 capacity);
+
+/*
+ * Description :
+ * Consume the bytes waiting in the UART receive buffer without blocking.
+ * Returns FRAME_PENDING until a whole frame was received, then FRAME_OK or the
+ * reason the frame was rejected. The receiver is ready for the next frame afterwards.
+ */
+FRAME_Status FRAME_poll(FRAME_RxType *rx);
+
+/*
+ * Description :
+ * Wait until a whole frame was received and return FRAME_OK or the reason it was rejected.
+ */
+FRAME_Status FRAME_receive(FRAME_RxType *rx);
+
+/*
+ * Description :
+ * Wait at most Timeout_ms milliseconds for a whole frame and return FRAME_OK, the reason
+ * it was rejected or FRAME_TIMEOUT. A frame cut by the timeout is dropped.
+ * Needs the system tick (Tick_init).
+ */
+FRAME_Status FRAME_receiveTimeout(FRAME_RxType *rx, uint32 Timeout_ms);
+
+/*
+ * Description :
+ * Return the number of frames rejected for a wrong CRC or length (saturates at FRAME_MAX_ERROR_COUNT).
+ */
+uint8 FRAME_getErrorCount(void);
+
+/*
+ * Description :
+ * Reset the counter of rejected frames.
+ */
+void FRAME_clearErrorCount(void);
+
+#endif /* FRAME_H_ */
@@ -169,6 +169,20 @@ void LCD_intgerToString(int data)
    LCD_displayString(buff);
 }
 
+/* Display the remaining time as MM:SS, the same width every time so it can be rewritten in place */
+void LCD_displayCountdown(uint8 row,uint8 col,uint16 seconds)
+{
+	uint8 minutes = seconds / 60;
+	seconds %= 60;
+
+	LCD_goToRowColumn(row,col);
+	LCD_displayCharacter('0' + (minutes / 10) % 10);
+	LCD_displayCharacter('0' + minutes % 10);
+	LCD_displayCharacter(':');
+	LCD_displayCharacter('0' + seconds / 10);
+	LCD_displayCharacter('0' + seconds % 10);
+}
+
 void LCD_clearScreen(void)
 {
 	LCD_sendCommand(CLEAR_COMMAND); //clear display 
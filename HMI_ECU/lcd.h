@@ -58,5 +58,6 @@ void LCD_clearScreen(void);
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 void LCD_goToRowColumn(uint8 row,uint8 col);
 void LCD_intgerToString(int data);
+void LCD_displayCountdown(uint8 row,uint8 col,uint16 seconds);
 
 #endif /* LCD_H_ */
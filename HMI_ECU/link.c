@@ -0,0 +1,322 @@
+/******************************************************************************
+ *
+ * Module: LINK
+ *
+ * File Name: link.c
+ *
+ * Description: Source file for the management of the UART link between the
+ * HMI ECU and the Control ECU.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#include "link.h"
+#include "uart.h"
+#include "frame.h"
+#include "timer.h"
+#include "micro_config.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Payload size of the propose/accept frames (baud rate, least significant byte first) */
+#define LINK_BAUD_PAYLOAD_SIZE 4
+
+/* Size of the probe pattern echoed at the new rate */
+#define LINK_PROBE_SIZE 8
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static const uint32 g_baudRates[LINK_NUMBER_OF_BAUD_RATES] = LINK_BAUD_RATES;
+
+/* Probe pattern with alternating bits, the frame start byte and long runs */
+static const uint8 g_probePattern[LINK_PROBE_SIZE] = {0x55, 0xAA, 0x00, 0xFF, 0x7E, 0x81, 0x0F, 0xF0};
+
+/* Baud rate currently used on the link */
+static uint32 g_currentBaud = LINK_BASE_BAUD;
+
+/* Index in g_baudRates of the fastest rate that may still be proposed */
+static uint8 g_firstAllowedRate = 0;
+
+/*******************************************************************************
+ *                      Private Functions Definitions                          *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return TRUE if the UBRR value for BaudRate is within LINK_MAX_BAUD_ERROR_PERMILLE of it.
+ */
+static bool LINK_isBaudAccurate(uint32 BaudRate)
+{
+	uint32 ubrr_value = (F_CPU / (BaudRate * 8UL)) - 1;
+	uint32 actual = F_CPU / (8UL * (ubrr_value + 1));
+	uint32 difference = (actual > BaudRate) ? (actual - BaudRate) : (BaudRate - actual);
+
+	return ((difference * 1000UL) / BaudRate) <= LINK_MAX_BAUD_ERROR_PERMILLE;
+}
+
+/*
+ * Description :
+ * Wait for a frame of the given type, other frames are ignored.
+ * Returns TRUE if it arrived with its CRC correct before the timeout.
+ */
+static bool LINK_waitFrameType(FRAME_RxType *rx, uint8 Type, uint16 Timeout_ms)
+{
+	FRAME_Status status;
+
+	do
+	{
+		status = FRAME_receiveTimeout(rx, Timeout_ms);
+		if((status == FRAME_OK) && (rx->type == Type))
+		{
+			return TRUE;
+		}
+	}
+	while(status != FRAME_TIMEOUT);
+
+	return FALSE;
+}
+
+static void LINK_packBaud(uint8 *Payload, uint32 BaudRate)
+{
+	uint8 i;
+
+	for(i = 0; i < LINK_BAUD_PAYLOAD_SIZE; i++)
+	{
+		Payload[i] = (uint8)(BaudRate >> (8 * i));
+	}
+}
+
+static uint32 LINK_unpackBaud(const uint8 *Payload)
+{
+	uint8 i;
+	uint32 BaudRate = 0;
+
+	for(i = 0; i < LINK_BAUD_PAYLOAD_SIZE; i++)
+	{
+		BaudRate |= (uint32)Payload[i] << (8 * i);
+	}
+	return BaudRate;
+}
+
+static bool LINK_isProbe(const FRAME_RxType *rx)
+{
+	uint8 i;
+
+	if(rx->length != LINK_PROBE_SIZE)
+	{
+		return FALSE;
+	}
+	for(i = 0; i < LINK_PROBE_SIZE; i++)
+	{
+		if(rx->buffer[i] != g_probePattern[i])
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Number of errors seen on the link: corrupted bytes, lost bytes and rejected frames.
+ */
+static uint16 LINK_getErrorCount(void)
+{
+	return (uint16)UART_getErrorCount() + UART_getOverrunCount() + FRAME_getErrorCount();
+}
+
+/*
+ * Description :
+ * Forget the errors counted by LINK_getErrorCount().
+ */
+static void LINK_clearErrorCount(void)
+{
+	UART_clearErrorCount();
+	FRAME_clearErrorCount();
+}
+
+/*
+ * Description :
+ * Wait until the transmit buffer is empty then change the rate and forget old errors.
+ */
+static void LINK_switchBaud(uint32 BaudRate)
+{
+	UART_flush();
+	UART_setBaudRate(BaudRate);
+	LINK_clearErrorCount();
+	g_currentBaud = BaudRate;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the UART at LINK_BASE_BAUD, 8 data bits, no parity and 1 stop bit.
+ * The negotiation timeouts need the system tick (Tick_init).
+ */
+void LINK_init(void)
+{
+	UART_ConfigType UART_Structure={EIGHT_BIT,DISABLED,ONE_BIT,LINK_BASE_BAUD};
+	UART_init(&UART_Structure);
+	g_currentBaud = LINK_BASE_BAUD;
+}
+
+/*
+ * Description :
+ * Run the negotiation as master (HMI ECU) and switch to the fastest rate the peer echoes cleanly.
+ * The peer must be told to call LINK_negotiateSlave() before.
+ * Returns TRUE if a faster rate was committed, FALSE if the link stays at LINK_BASE_BAUD.
+ */
+bool LINK_negotiateMaster(void)
+{
+	uint8 i, Attempt;
+	uint8 Payload[LINK_PROBE_SIZE];
+	FRAME_RxType Reply;
+
+	for(i = g_firstAllowedRate; i < LINK_NUMBER_OF_BAUD_RATES; i++)
+	{
+		if(!LINK_isBaudAccurate(g_baudRates[i]))
+		{
+			continue;
+		}
+
+		/* Propose the rate at the base rate */
+		LINK_packBaud(Payload, g_baudRates[i]);
+		FRAME_send(FRAME_LINK_PROPOSE, 0, Payload, LINK_BAUD_PAYLOAD_SIZE);
+		FRAME_initReceiver(&Reply, Payload, LINK_PROBE_SIZE);
+		if(!LINK_waitFrameType(&Reply, FRAME_LINK_ACCEPT, LINK_REPLY_TIMEOUT_MS))
+		{
+			/* The peer does not answer even at the base rate */
+			return FALSE;
+		}
+
+		/* Check the new rate with a probe echoed by the peer once it switched as well */
+		LINK_switchBaud(g_baudRates[i]);
+		_delay_ms(LINK_SWITCH_DELAY_MS);
+		FRAME_send(FRAME_LINK_PROBE, 0, g_probePattern, LINK_PROBE_SIZE);
+		FRAME_initReceiver(&Reply, Payload, LINK_PROBE_SIZE);
+		if(LINK_waitFrameType(&Reply, FRAME_LINK_PROBE, LINK_REPLY_TIMEOUT_MS) &&
+				LINK_isProbe(&Reply) && (LINK_getErrorCount() == 0))
+		{
+			/* The rate is only kept once the peer echoed the commit at the new rate */
+			for(Attempt = 0; Attempt < LINK_COMMIT_RETRIES; Attempt++)
+			{
+				FRAME_send(FRAME_LINK_COMMIT, 0, NULL_PTR, 0);
+				FRAME_initReceiver(&Reply, Payload, LINK_PROBE_SIZE);
+				if(LINK_waitFrameType(&Reply, FRAME_LINK_COMMIT, LINK_REPLY_TIMEOUT_MS))
+				{
+					return TRUE;
+				}
+			}
+		}
+
+		/* Go back to the base rate once the peer gave up as well */
+		LINK_switchBaud(LINK_BASE_BAUD);
+		_delay_ms(LINK_SETTLE_TIME_MS);
+		UART_clearReceiveBuffer();
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Answer a negotiation started by LINK_negotiateMaster() (Control ECU).
+ * Returns once a rate was committed or no proposal came for LINK_PROPOSE_TIMEOUT_MS.
+ */
+void LINK_negotiateSlave(void)
+{
+	uint8 Payload[LINK_PROBE_SIZE];
+	uint32 BaudRate;
+	FRAME_RxType Request;
+
+	while(1)
+	{
+		FRAME_initReceiver(&Request, Payload, LINK_PROBE_SIZE);
+		if(!LINK_waitFrameType(&Request, FRAME_LINK_PROPOSE, LINK_PROPOSE_TIMEOUT_MS) ||
+				(Request.length != LINK_BAUD_PAYLOAD_SIZE))
+		{
+			/* Master is done or gave up */
+			return;
+		}
+
+		BaudRate = LINK_unpackBaud(Payload);
+		if(!LINK_isBaudAccurate(BaudRate))
+		{
+			/* No answer makes the master stop at the base rate */
+			return;
+		}
+		FRAME_send(FRAME_LINK_ACCEPT, 0, Payload, LINK_BAUD_PAYLOAD_SIZE);
+		LINK_switchBaud(BaudRate);
+
+		/* Echo the probe and wait for the master to commit the rate */
+		FRAME_initReceiver(&Request, Payload, LINK_PROBE_SIZE);
+		if(LINK_waitFrameType(&Request, FRAME_LINK_PROBE, LINK_REPLY_TIMEOUT_MS) && LINK_isProbe(&Request))
+		{
+			FRAME_send(FRAME_LINK_PROBE, 0, Payload, LINK_PROBE_SIZE);
+			FRAME_initReceiver(&Request, Payload, LINK_PROBE_SIZE);
+			if(LINK_waitFrameType(&Request, FRAME_LINK_COMMIT, LINK_REPLY_TIMEOUT_MS))
+			{
+				/* Echo the commit, and again every time the master repeats it because an echo was lost */
+				do
+				{
+					FRAME_send(FRAME_LINK_COMMIT, 0, NULL_PTR, 0);
+					FRAME_initReceiver(&Request, Payload, LINK_PROBE_SIZE);
+				}
+				while(LINK_waitFrameType(&Request, FRAME_LINK_COMMIT, LINK_REPLY_TIMEOUT_MS));
+				return;
+			}
+		}
+
+		/* Rate did not work, go back to the base rate and wait for the next proposal */
+		LINK_switchBaud(LINK_BASE_BAUD);
+	}
+}
+
+/*
+ * Description :
+ * Fall back to LINK_BASE_BAUD if too many bytes were corrupted or lost or too many frames rejected.
+ * The failed rate and every faster one are not proposed again.
+ * Returns TRUE if the link fell back during this call.
+ */
+bool LINK_monitor(void)
+{
+	uint8 i;
+
+	if(LINK_getErrorCount() < LINK_ERROR_THRESHOLD)
+	{
+		return FALSE;
+	}
+
+	if(g_currentBaud == LINK_BASE_BAUD)
+	{
+		/* Nothing slower to fall back to */
+		LINK_clearErrorCount();
+		return FALSE;
+	}
+
+	for(i = 0; i < LINK_NUMBER_OF_BAUD_RATES; i++)
+	{
+		if(g_baudRates[i] == g_currentBaud)
+		{
+			g_firstAllowedRate = i + 1;
+		}
+	}
+	LINK_switchBaud(LINK_BASE_BAUD);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the baud rate currently used on the link.
+ */
+uint32 LINK_getBaudRate(void)
+{
+	return g_currentBaud;
+}
@@ -0,0 +1,149 @@
+/******************************************************************************
+ *
+ * Module: PROTOCOL
+ *
+ * File Name: protocol.h
+ *
+ * Description: Header file for the request/response protocol between the HMI ECU
+ * and the Control ECU.
+ *
+ * The HMI ECU (master) sends every request as a frame with a new sequence number
+ * and waits for the response, a frame with the same sequence number and the type
+ * of the request with PROTOCOL_RESPONSE_FLAG set. The response is the
+ * acknowledgement: if it does not arrive within PROTOCOL_RESPONSE_TIMEOUT_MS, or
+ * the Control ECU (slave) answers with a FRAME_NACK because the request was
+ * corrupted, the request is sent again up to PROTOCOL_MAX_RETRIES times.
+ * The slave remembers its last response and sends it again for a repeated
+ * request instead of executing the request twice. Sequence number 0 is only used
+ * by the first request after a reset of the master and is never taken as a repeat.
+ *
+ * The slave may also send notifications on its own. They are not acknowledged,
+ * so a notification that may be lost must be sent again periodically.
+ *
+ * Author: Sarah Emil
+ *
+ *******************************************************************************/
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Requests of the HMI ECU
+ *                                 Request payload   Response payload          */
+#define MSG_LINK_NEGOTIATE   0x20 /* -               TRUE, then the link negotiation runs */
+#define MSG_PASSWORD_STATUS  0x21 /* -               TRUE if a password is saved */
+#define MSG_UNLOCK           0x22 /* action, digits  TRUE if the password is correct and the action started */
+#define MSG_NEW_PASSWORD     0x24 /* digits          TRUE if the password may be changed */
+#define MSG_CONFIRM_PASSWORD 0x25 /* digits          TRUE if it matches the new one and was saved */
+#define MSG_DOOR_STATUS      0x26 /* -               door phase, seconds left in the phase */
+#define MSG_AUDIT_DUMP       0x28 /* index           entries in the log, then up to AUDIT_DUMP_MAX_ENTRIES entries from index on (0 the oldest),
+                                   *                 empty unless a MSG_UNLOCK with UNLOCK_AUDIT_LOG just succeeded */
+
+/* Notifications of the Control ECU, sent without a request and never answered
+ *                                 Payload                                     */
+#define MSG_ALARM_COUNTDOWN  0x30 /* seconds left in the alarm lockout, 0 when it is over */
+
+/* Actions of MSG_UNLOCK, the keys of the main menu */
+#define UNLOCK_OPEN_DOOR       '+'
+#define UNLOCK_CHANGE_PASSWORD '-'
+#define UNLOCK_AUDIT_LOG       '*'
+
+/* Door phases of MSG_DOOR_STATUS */
+#define DOOR_STATUS_LOCKED  0
+#define DOOR_STATUS_OPENING 1
+#define DOOR_STATUS_HELD    2
+#define DOOR_STATUS_CLOSING 3
+
+/* Entries of MSG_AUDIT_DUMP: sequence number (16 bits), event, user, seconds since boot (32 bits), little endian */
+#define AUDIT_DUMP_ENTRY_SIZE  8
+#define AUDIT_DUMP_MAX_ENTRIES 3
+
+/* Events of the audit log entries */
+#define AUDIT_EVENT_BOOT            0
+#define AUDIT_EVENT_UNLOCK          1
+#define AUDIT_EVENT_WRONG_PASSWORD  2
+#define AUDIT_EVENT_LOCKOUT         3
+#define AUDIT_EVENT_PASSWORD_CHANGE 4
+
+/* User of an entry not made by a user */
+#define AUDIT_USER_NONE 0xFF
+
+/* Set in the type of a response frame */
+#define PROTOCOL_RESPONSE_FLAG 0x80
+
+/* Time the master waits for a response before sending the request again */
+#define PROTOCOL_RESPONSE_TIMEOUT_MS 250
+
+/* Number of times a request is repeated before the master gives up */
+#define PROTOCOL_MAX_RETRIES 3
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+typedef struct
+{
+	uint8 type;     /* Message type of the request */
+	uint8 seq;      /* Sequence number to put in the response */
+	uint8 length;   /* Payload length */
+	uint8 *payload; /* Payload, valid until the next call of PROTOCOL_pollRequest() or PROTOCOL_pollNotification() */
+}PROTOCOL_RequestType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Reset the protocol state, call once after the UART is initialized.
+ */
+void PROTOCOL_init(void);
+
+/*
+ * Description :
+ * Master: send a request and wait for its response, repeating the request if needed.
+ * The response payload is received in response (capacity bytes at most) and its length
+ * stored in responseLength unless it is NULL_PTR.
+ * Returns FALSE if the slave did not answer.
+ */
+bool PROTOCOL_request(uint8 type, const uint8 *payload, uint8 length,
+		uint8 *response, uint8 capacity, uint8 *responseLength);
+
+/*
+ * Description :
+ * Slave: check for a new request without blocking.
+ * Returns TRUE and fills request when one was received. Repeated requests are answered
+ * with the remembered response and corrupted ones with a FRAME_NACK.
+ */
+bool PROTOCOL_pollRequest(PROTOCOL_RequestType *request);
+
+/*
+ * Description :
+ * Slave: send the response of a request and remember it in case the request is repeated.
+ */
+void PROTOCOL_respond(const PROTOCOL_RequestType *request, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Slave: drop everything received while the application could not answer requests.
+ */
+void PROTOCOL_flush(void);
+
+/*
+ * Description :
+ * Slave: send a notification to the master.
+ */
+void PROTOCOL_notify(uint8 type, const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Master: check for a notification from the slave without blocking.
+ * Returns TRUE and fills notification when one was received.
+ */
+bool PROTOCOL_pollNotification(PROTOCOL_RequestType *notification);
+
+#endif /* PROTOCOL_H_ */
@@ -27,6 +27,8 @@ typedef unsigned char bool;
 #define HIGH        (1u)
 #define LOW         (0u)
 
+#define NULL_PTR    ((void*)0)
+
 typedef unsigned char         uint8;          /*           0 .. 255             */
 typedef signed char           sint8;          /*        -128 .. +127            */
 typedef unsigned short        uint16;         /*           0 .. 65535           */
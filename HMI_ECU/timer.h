@@ -47,9 +47,85 @@ uint16 compare_value; // it will be used in compare mode only/
 
 
 
+/* System tick: Timer1 free running in CTC mode at F_CPU/64 (8 us per count at 8MHz) */
+#define TICK_PRESCALER       F_CPU_64
+#define TICK_CLOCK_HZ        (F_CPU / 64UL)
+
+/* Interrupt every TICK_COMPARE_VALUE+1 counts, at most 1 ms (125 counts give exactly 1 ms at 8MHz).
+ * When F_CPU/64 is not a multiple of 1000 the remainder is kept in a fractional accumulator
+ * so the millisecond count never drifts. */
+#define TICK_COMPARE_VALUE   ((TICK_CLOCK_HZ / 1000UL) - 1)
+
+/* Accumulator increment per interrupt, in units of 1/1000 count: one millisecond is TICK_CLOCK_HZ units */
+#define TICK_FRACTION_PER_INTERRUPT ((TICK_COMPARE_VALUE + 1) * 1000UL)
+
+/* Number of software timers multiplexed on the system tick */
+#define SOFT_TIMER_MAX_NUMBER 8
+
+/* Returned by SoftTimer_create() when all the software timers are in use */
+#define SOFT_TIMER_INVALID    0xFF
+
+typedef enum
+{
+	SOFT_TIMER_ONE_SHOT,SOFT_TIMER_PERIODIC
+}SoftTimer_Mode;
+
 /*             Functions Prototypes               */
 
 void Timer1_init(const Timer1_ConfigType * Config_Ptr);
 void Timer1_DeInit();
 void Timer1_setCallBack(void(*aTimer_ptr)(void));
+
+/*
+ * Description: Start the 1 ms system tick on Timer1 used for timeouts and software timers.
+ * Timer1 keeps running from now on, so it must not be reconfigured by the application.
+ */
+void Tick_init(void);
+
+/*
+ * Description: Return the number of milliseconds elapsed since Tick_init() (millis).
+ * Wraps around after about 49 days.
+ */
+uint32 Tick_getMs(void);
+
+/*
+ * Description: Return the number of microseconds elapsed since Tick_init() (micros),
+ * with the resolution of one Timer1 count. Wraps around after about 71 minutes,
+ * differences of two readings stay correct across the wrap around.
+ */
+uint32 Tick_getUs(void);
+
+/*
+ * Description: Return TRUE once Timeout_ms milliseconds passed since the Start tick.
+ * Correct across the wrap around of the tick counter.
+ */
+bool Tick_isElapsed(uint32 Start, uint32 Timeout_ms);
+
+/*
+ * Description: Reserve a software timer calling aCallBack_ptr on every expiry.
+ * The call back runs from the tick interrupt so it must be short (set a flag, start an action).
+ * Return the timer id or SOFT_TIMER_INVALID if all the timers are in use.
+ */
+uint8 SoftTimer_create(void(*aCallBack_ptr)(void));
+
+/*
+ * Description: (Re)start a software timer to expire after Period_ms milliseconds,
+ * once (SOFT_TIMER_ONE_SHOT) or every Period_ms (SOFT_TIMER_PERIODIC).
+ */
+void SoftTimer_start(uint8 Id, uint32 Period_ms, SoftTimer_Mode Mode);
+
+/*
+ * Description: Stop a software timer without calling its call back.
+ */
+void SoftTimer_stop(uint8 Id);
+
+/*
+ * Description: Return TRUE while the software timer is counting.
+ */
+bool SoftTimer_isRunning(uint8 Id);
+
+/*
+ * Description: Return the milliseconds left before the software timer expires, 0 if it is stopped.
+ */
+uint32 SoftTimer_getRemainingMs(uint8 Id);
 #endif /* TIMER_H_ */
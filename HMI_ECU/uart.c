@@ -13,7 +13,90 @@
 
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
+#include <avr/interrupt.h> /* For UART ISR */
 #include "common_macros.h" /* To use the macros like SET_BIT */
+#include "timer.h" /* For the receive timeouts */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Receive ring buffer, written by the RX complete ISR and read by the application */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0; /* Next free position, only modified by the ISR */
+static volatile uint8 g_rxTail = 0; /* Next byte to read, only modified by the application */
+
+/* Number of received bytes that were lost */
+static volatile uint8 g_rxOverrunCount = 0;
+
+/* Number of received bytes dropped because of a framing or parity error */
+static volatile uint8 g_rxErrorCount = 0;
+
+/* Transmit ring buffer, written by the application and drained by the UDRE ISR */
+static volatile uint8 g_txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint8 g_txHead = 0; /* Next free position, only modified by the application */
+static volatile uint8 g_txTail = 0; /* Next byte to send, only modified by the ISR */
+
+/* Set when a byte was queued since the last UART_flush() */
+static volatile bool g_txStarted = FALSE;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+ISR(USART_RXC_vect)
+{
+	uint8 status = UCSRA;
+	uint8 data = UDR; /* Reading UDR clears the RXC flag */
+	uint8 next = (g_rxHead + 1) & UART_RX_BUFFER_MASK;
+
+	/* A byte was lost in the hardware before this one could be read */
+	if(BIT_IS_SET(status,DOR) && (g_rxOverrunCount != UART_MAX_OVERRUN_COUNT))
+	{
+		g_rxOverrunCount++;
+	}
+
+	if(status & ((1<<FE) | (1<<PE)))
+	{
+		/* Byte was corrupted on the line (or the peer uses another baud rate), drop it */
+		if(g_rxErrorCount != UART_MAX_ERROR_COUNT)
+		{
+			g_rxErrorCount++;
+		}
+	}
+	else if(next == g_rxTail)
+	{
+		/* Buffer is full, drop the new byte */
+		if(g_rxOverrunCount != UART_MAX_OVERRUN_COUNT)
+		{
+			g_rxOverrunCount++;
+		}
+	}
+	else
+	{
+		g_rxBuffer[g_rxHead] = data;
+		g_rxHead = next;
+	}
+}
+
+ISR(USART_UDRE_vect)
+{
+	uint8 tail = g_txTail;
+
+	if(tail == g_txHead)
+	{
+		/* Nothing left to send, disable the interrupt until a new byte is queued */
+		CLEAR_BIT(UCSRB,UDRIE);
+	}
+	else
+	{
+		/* Clear the TXC flag so UART_flush() can detect the end of this byte */
+		SET_BIT(UCSRA,TXC);
+		UDR = g_txBuffer[tail];
+		g_txTail = (tail + 1) & UART_TX_BUFFER_MASK;
+	}
+}
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -27,21 +110,30 @@
  */
 void UART_init(const UART_ConfigType * Config_Ptr)
 {
-	uint16 ubrr_value = 0;
-
 	/* U2X = 1 for double transmission speed */
 	UCSRA = (1<<U2X);
 
+	/* Flush the receive buffer */
+	g_rxHead = 0;
+	g_rxTail = 0;
+	g_rxOverrunCount = 0;
+	g_rxErrorCount = 0;
+
+	/* Flush the transmit buffer */
+	g_txHead = 0;
+	g_txTail = 0;
+	g_txStarted = FALSE;
+
 	/************************** UCSRB Description **************************
-	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
+	 * RXCIE = 1 Enable USART RX Complete Interrupt Enable
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
-	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
+	 * UDRIE = 0 Data Register Empty Interrupt is enabled by UART_sendByte when data is queued
 	 * RXEN  = 1 Receiver Enable
 	 * RXEN  = 1 Transmitter Enable
 	 * UCSZ2 = 0 For 8-bit data mode
 	 * RXB8 & TXB8 not used for 8-bit data mode
 	 ***********************************************************************/ 
-	UCSRB = (1<<RXEN) | (1<<TXEN);
+	UCSRB = (1<<RXCIE) | (1<<RXEN) | (1<<TXEN);
 
 	/************************** UCSRC Description **************************
 	 * URSEL   = 1 The URSEL must be one when writing the UCSRC
@@ -66,8 +158,22 @@ void UART_init(const UART_ConfigType * Config_Ptr)
 		UCSRC |= Config_Ptr->bit_data;
 
 	}
+	UART_setBaudRate(Config_Ptr->BaudRate);
+
+	SREG  |= (1<<7);           // Enable global interrupts in MC.
+}
+
+/*
+ * Description :
+ * Change the baud rate of an initialized UART device keeping its frame format.
+ * Bytes still in the transmit buffer are sent with the new rate, call UART_flush() first.
+ */
+void UART_setBaudRate(uint32 BaudRate)
+{
+	uint16 ubrr_value = 0;
+
 	/* Calculate the UBRR register value */
-	ubrr_value = (uint16)(((F_CPU / (Config_Ptr->BaudRate * 8UL))) - 1);
+	ubrr_value = (uint16)(((F_CPU / (BaudRate * 8UL))) - 1);
 
 	/* First 8 bits from the BAUD_PRESCALE inside UBRRL and last 4 bits in UBRRH*/
 	UBRRH = ubrr_value>>8;
@@ -77,42 +183,155 @@ void UART_init(const UART_ConfigType * Config_Ptr)
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * The byte is queued in the transmit buffer and the function returns immediately
+ * unless the buffer is full.
  */
 void UART_sendByte(const uint8 data)
 {
-	/*
-	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
-	 * transmitting a new byte so wait until this flag is set to one
-	 */
-	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
-
-	/*
-	 * Put the required data in the UDR register and it also clear the UDRE flag as
-	 * the UDR register is not empty now
-	 */
-	UDR = data;
-
-	/****************** BIT_IS_CLEAR BIT_IS_CLEAR******* Another Method *************************
-	UDR = data;
-	while(BIT_IS_CLEAR(UCSRA,TXC)){} // Wait until the transmission is complete TXC = 1
-	SET_BIT(UCSRA,TXC); // Clear the TXC flag
-	 *******************************************************************/
+	uint8 head = g_txHead;
+	uint8 next = (head + 1) & UART_TX_BUFFER_MASK;
+
+	/* Buffer is full so wait until the UDRE ISR makes room for the new byte */
+	while(next == g_txTail){}
+
+	g_txBuffer[head] = data;
+	g_txHead = next;
+	g_txStarted = TRUE;
+
+	/* The UDRE ISR will move the byte to UDR as soon as the Tx buffer (UDR) is empty */
+	SET_BIT(UCSRB,UDRIE);
+}
+
+/*
+ * Description :
+ * Return the number of bytes still waiting in the transmit buffer.
+ */
+uint8 UART_txPending(void)
+{
+	return (g_txHead - g_txTail) & UART_TX_BUFFER_MASK;
+}
+
+/*
+ * Description :
+ * Wait until every queued byte has been completely shifted out on the TX line.
+ */
+void UART_flush(void)
+{
+	if(!g_txStarted)
+	{
+		return;
+	}
+
+	/* Wait until the ISR has moved the last byte to UDR and disabled itself */
+	while(BIT_IS_SET(UCSRB,UDRIE)){}
+
+	/* TXC flag is set when the last byte has left the shift register */
+	while(BIT_IS_CLEAR(UCSRA,TXC)){}
+
+	g_txStarted = FALSE;
 }
 
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * Waits until a byte is available in the receive buffer.
  */
 uint8 UART_recieveByte(void)
 {
-	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
-	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
+	uint8 data;
+
+	/* The RX complete ISR fills the buffer so wait until it holds a byte */
+	while(!UART_tryReceiveByte(&data)){}
 
-	/*
-	 * Read the received data from the Rx buffer (UDR)
-	 * The RXC flag will be cleared after read the data
-	 */
-	return UDR;
+	return data;
+}
+
+/*
+ * Description :
+ * Wait at most Timeout_ms milliseconds for a received byte.
+ * Returns TRUE and stores the byte in data if one arrived in time, FALSE otherwise.
+ * Needs the system tick (Tick_init).
+ */
+bool UART_receiveByteTimeout(uint8 *data, uint32 Timeout_ms)
+{
+	uint32 start = Tick_getMs();
+
+	while(!UART_tryReceiveByte(data))
+	{
+		if(Tick_isElapsed(start, Timeout_ms))
+		{
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes waiting in the receive buffer.
+ */
+uint8 UART_available(void)
+{
+	return (g_rxHead - g_rxTail) & UART_RX_BUFFER_MASK;
+}
+
+/*
+ * Description :
+ * Drop every byte waiting in the receive buffer, used to resynchronise with the other device.
+ */
+void UART_clearReceiveBuffer(void)
+{
+	/* Only the tail belongs to the application, bytes received meanwhile are kept */
+	g_rxTail = g_rxHead;
+}
+
+/*
+ * Description :
+ * Take one byte from the receive buffer without waiting.
+ * Returns TRUE and stores the byte in data if one was available, FALSE otherwise.
+ */
+bool UART_tryReceiveByte(uint8 *data)
+{
+	uint8 tail = g_rxTail;
+
+	if(tail == g_rxHead)
+	{
+		return FALSE;
+	}
+
+	*data = g_rxBuffer[tail];
+	g_rxTail = (tail + 1) & UART_RX_BUFFER_MASK;
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes lost either by a hardware data overrun
+ * or because the receive buffer was full (saturates at UART_MAX_OVERRUN_COUNT).
+ */
+uint8 UART_getOverrunCount(void)
+{
+	return g_rxOverrunCount;
+}
+
+/*
+ * Description :
+ * Return the number of received bytes dropped because of a framing or parity error
+ * (saturates at UART_MAX_ERROR_COUNT).
+ */
+uint8 UART_getErrorCount(void)
+{
+	return g_rxErrorCount;
+}
+
+/*
+ * Description :
+ * Reset the framing/parity error counter and the lost bytes counter.
+ */
+void UART_clearErrorCount(void)
+{
+	g_rxErrorCount = 0;
+	g_rxOverrunCount = 0;
 }
 
 /*
@@ -137,25 +356,3 @@ void UART_sendString(const uint8 *Str)
 	}		
 	 *******************************************************************/
 }
-
-/*
- * Description :
- * Receive the required string until the '#' symbol through UART from the other UART device.
- */
-void UART_receiveString(uint8 *Str)
-{
-	uint8 i = 0;
-
-	/* Receive the first byte */
-	Str[i] = UART_recieveByte();
-
-	/* Receive the whole string until the '#' */
-	while(Str[i] != '#')
-	{
-		i++;
-		Str[i] = UART_recieveByte();
-	}
-
-	/* After receiving the whole string plus the '#', replace the '#' with '\0' */
-	Str[i] = '\0';
-}
@@ -15,6 +15,22 @@
 
 #include "std_types.h"
 
+/*******************************************************************************
+ *                      Preprocessor Macros                                    *
+ *******************************************************************************/
+
+/* Size of the receive ring buffer filled by the RX complete interrupt (must be a power of 2) */
+#define UART_RX_BUFFER_SIZE 32
+#define UART_RX_BUFFER_MASK (UART_RX_BUFFER_SIZE - 1)
+
+/* Size of the transmit ring buffer drained by the data register empty interrupt (must be a power of 2) */
+#define UART_TX_BUFFER_SIZE 32
+#define UART_TX_BUFFER_MASK (UART_TX_BUFFER_SIZE - 1)
+
+/* Maximum value the overrun and error counters saturate at */
+#define UART_MAX_OVERRUN_COUNT 0xFF
+#define UART_MAX_ERROR_COUNT 0xFF
+
 typedef enum
 {
 	FIVE_BIT, SIX_BIT=2, SEVEN_BIT=4, EIGHT_BIT=6, NINE_BIT
@@ -54,28 +70,92 @@ typedef struct{
  */
 void UART_init(const UART_ConfigType * Config_Ptr);
 
+/*
+ * Description :
+ * Change the baud rate of an initialized UART device keeping its frame format.
+ * Bytes still in the transmit buffer are sent with the new rate, call UART_flush() first.
+ */
+void UART_setBaudRate(uint32 BaudRate);
+
 /*
  * Description :
  * Functional responsible for send byte to another UART device.
+ * The byte is queued in the transmit buffer and the function returns immediately
+ * unless the buffer is full.
  */
 void UART_sendByte(const uint8 data);
 
+/*
+ * Description :
+ * Return the number of bytes still waiting in the transmit buffer.
+ */
+uint8 UART_txPending(void);
+
+/*
+ * Description :
+ * Wait until every queued byte has been completely shifted out on the TX line.
+ */
+void UART_flush(void);
+
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * Waits until a byte is available in the receive buffer.
  */
 uint8 UART_recieveByte(void);
 
 /*
  * Description :
- * Send the required string through UART to the other UART device.
+ * Wait at most Timeout_ms milliseconds for a received byte.
+ * Returns TRUE and stores the byte in data if one arrived in time, FALSE otherwise.
+ * Needs the system tick (Tick_init).
  */
-void UART_sendString(const uint8 *Str);
+bool UART_receiveByteTimeout(uint8 *data, uint32 Timeout_ms);
+
+/*
+ * Description :
+ * Return the number of received bytes waiting in the receive buffer.
+ */
+uint8 UART_available(void);
+
+/*
+ * Description :
+ * Drop every byte waiting in the receive buffer, used to resynchronise with the other device.
+ */
+void UART_clearReceiveBuffer(void);
+
+/*
+ * Description :
+ * Take one byte from the receive buffer without waiting.
+ * Returns TRUE and stores the byte in data if one was available, FALSE otherwise.
+ */
+bool UART_tryReceiveByte(uint8 *data);
 
 /*
  * Description :
- * Receive the required string until the '#' symbol through UART from the other UART device.
+ * Return the number of received bytes lost either by a hardware data overrun
+ * or because the receive buffer was full (saturates at UART_MAX_OVERRUN_COUNT).
  */
-void UART_receiveString(uint8 *Str); // Receive until #
+uint8 UART_getOverrunCount(void);
+
+/*
+ * Description :
+ * Return the number of received bytes dropped because of a framing or parity error
+ * (saturates at UART_MAX_ERROR_COUNT).
+ */
+uint8 UART_getErrorCount(void);
+
+/*
+ * Description :
+ * Reset the framing/parity error counter and the lost bytes counter.
+ */
+void UART_clearErrorCount(void);
+
+/*
+ * Description :
+ * Send the required string through UART to the other UART device.
+ * Returns as soon as the string is queued in the transmit buffer.
+ */
+void UART_sendString(const uint8 *Str);
 
 #endif /* UART_H_ */